@@ -0,0 +1,192 @@
+//
+// Created by Dogs-Cute on 10/17/2026.
+//
+
+#ifndef SDLCLASS_EXTATLAS_HPP
+#define SDLCLASS_EXTATLAS_HPP
+
+#include "ExtBase.h"
+
+NS_BEGIN
+/*Packs many surfaces into a few large pages with a skyline packer, so they can be copied from one bound texture*/
+    class Atlas final {
+    public:
+        /*A handle of a packed surface : the page index and the sub-rect on that page*/
+        struct Region {
+            size_t page;
+            Rect rect;
+        };
+
+    protected:
+        using PointRef = const Point &;
+
+        struct SkylineNode {
+            int x, y, w;
+        };
+
+        struct AtlasPage {
+            std::unique_ptr<Surface> surface;
+            std::unique_ptr<Texture> texture;
+            std::vector<SkylineNode> skyline;
+            bool dirty = true;
+        };
+
+        Point page_size;
+        int padding;
+        std::vector<AtlasPage> pages;
+
+        // The lowest y that a rect of width w can be placed at starting from node index, or -1 if not fitting
+        [[nodiscard]] int fit(const AtlasPage &page, size_t index, int w, int h) const noexcept {
+            int x = page.skyline[index].x, y = 0, width_left = w;
+            if (x + w > page_size.x)
+                return -1;
+            for (size_t i = index; width_left > 0; i++) {
+                if (i == page.skyline.size())
+                    return -1;
+                y = std::max(y, page.skyline[i].y);
+                if (y + h > page_size.y)
+                    return -1;
+                width_left -= page.skyline[i].w;
+            }
+            return y;
+        }
+
+        // Find the bottom-left position of a rect on the page, returning false if there is no room
+        bool find_position(const AtlasPage &page, int w, int h, size_t &best_index, Point &best_pos) const noexcept {
+            int best_bottom = max_of(int), best_width = max_of(int);
+            bool found = false;
+            for (size_t i = 0; i < page.skyline.size(); i++) {
+                int y = fit(page, i, w, h);
+                if (y < 0)
+                    continue;
+                int bottom = y + h;
+                if (bottom < best_bottom || (bottom == best_bottom && page.skyline[i].w < best_width)) {
+                    best_bottom = bottom;
+                    best_width = page.skyline[i].w;
+                    best_index = i;
+                    best_pos = {page.skyline[i].x, y};
+                    found = true;
+                }
+            }
+            return found;
+        }
+
+        static void add_skyline_level(AtlasPage &page, size_t index, const Point &pos, int w, int h) {
+            auto &skyline = page.skyline;
+            skyline.insert(skyline.begin() + static_cast<std::ptrdiff_t>(index), {pos.x, pos.y + h, w});
+            for (size_t i = index + 1; i < skyline.size();) {
+                auto &prev = skyline[i - 1];
+                auto &node = skyline[i];
+                if (node.x >= prev.x + prev.w)
+                    break;
+                int shrink = prev.x + prev.w - node.x;
+                node.x += shrink;
+                node.w -= shrink;
+                if (node.w > 0)
+                    break;
+                skyline.erase(skyline.begin() + static_cast<std::ptrdiff_t>(i));
+            }
+            for (size_t i = 0; i + 1 < skyline.size();) {
+                if (skyline[i].y == skyline[i + 1].y) {
+                    skyline[i].w += skyline[i + 1].w;
+                    skyline.erase(skyline.begin() + static_cast<std::ptrdiff_t>(i + 1));
+                } else i++;
+            }
+        }
+
+        AtlasPage &new_page() {
+            AtlasPage page;
+            page.surface = std::make_unique<Surface>(
+                    SDL_CreateRGBSurfaceWithFormat(0, page_size.x, page_size.y, 32, SDL_PIXELFORMAT_ARGB8888));
+            if (page.surface->ptr() == nullptr)
+                throw std::runtime_error("Cannot create atlas page sized " + std::to_string(page_size.x) + "x" +
+                                         std::to_string(page_size.y));
+            page.surface->set_blend(SDL_BLENDMODE_BLEND);
+            page.skyline.push_back({0, 0, page_size.x});
+            pages.push_back(std::move(page));
+            return pages.back();
+        }
+
+    public:
+/**
+ * \param page_size the size of every page texture. Defaults to 1024x1024
+ * \param padding the transparent pixels kept around every region to prevent sampling bleeding. Defaults to 1*/
+        explicit Atlas(const Point &page_size = {1024, 1024}, int padding = 1) :
+                page_size(page_size), padding(padding) {}
+
+        Atlas(const Atlas &) = delete;
+
+        Atlas &operator=(const Atlas &) = delete;
+
+/**
+ * Pack a copy of the surface into the atlas, the surface itself is not kept.
+ * \return the region where the surface is put at*/
+        Region insert(SDLSurfacePtr surface) {
+            int w = surface->w + padding * 2, h = surface->h + padding * 2;
+            if (w > page_size.x || h > page_size.y)
+                throw std::invalid_argument("Atlas cannot contain a surface sized " + std::to_string(surface->w) +
+                                            "x" + std::to_string(surface->h));
+            size_t index = 0;
+            Point pos;
+            size_t page_index = 0;
+            for (; page_index < pages.size(); page_index++)
+                if (find_position(pages[page_index], w, h, index, pos))
+                    break;
+            if (page_index == pages.size())
+                find_position(new_page(), w, h, index, pos);
+            auto &page = pages[page_index];
+            add_skyline_level(page, index, pos, w, h);
+
+            Rect rect{pos.x + padding, pos.y + padding, surface->w, surface->h}, dstrect = rect;
+            SDL_BlendMode blend_mode;
+            SDL_GetSurfaceBlendMode(surface, &blend_mode);
+            SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+            page.surface->blit(surface, dstrect);
+            SDL_SetSurfaceBlendMode(surface, blend_mode);
+            page.dirty = true;
+            return {page_index, rect};
+        }
+
+        /*Upload the pages changed since the last upload, updating the existing page textures in place*/
+        void upload(Renderer &renderer) {
+            for (auto &page: pages) {
+                if (!page.dirty)
+                    continue;
+                if (!page.texture) {
+                    page.texture = std::make_unique<Texture>(
+                            SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC,
+                                              page_size.x, page_size.y));
+                    page.texture->set_blend(SDL_BLENDMODE_BLEND);
+                }
+                SDLSurfacePtr surface = *page.surface;
+                SDL_UpdateTexture(*page.texture, nullptr, surface->pixels, surface->pitch);
+                page.dirty = false;
+            }
+        }
+
+        /*The texture of the page, valid after upload()*/
+        [[nodiscard]] TextureBase &texture(size_t page) const {
+            return *pages.at(page).texture;
+        }
+
+        void copy_to(Renderer &renderer, const Region &region, const SDL_Rect *dstrect) {
+            if (pages.at(region.page).dirty)
+                upload(renderer);
+            texture(region.page).copy_to(renderer, region.rect, dstrect);
+        }
+
+        void copy_to(Renderer &renderer, const Region &region, PointRef dst) {
+            copy_to(renderer, region, Rect{dst.x, dst.y, region.rect.w, region.rect.h});
+        }
+
+        [[nodiscard]] size_t page_count() const noexcept {
+            return pages.size();
+        }
+
+        void clear() noexcept {
+            pages.clear();
+        }
+    };
+NS_END
+
+#endif //SDLCLASS_EXTATLAS_HPP
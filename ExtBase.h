@@ -11,6 +11,7 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include <tuple>
 #include <unordered_map>
 #include <filesystem>
 #include <functional>
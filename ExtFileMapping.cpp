@@ -0,0 +1,47 @@
+//
+// Created by Dogs-Cute on 10/17/2026.
+//
+
+#include "ExtFileMapping.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace SDLExt {
+    char *map_file(const char *file, size_t &length) {
+        int fd = open(file, O_RDONLY);
+        if (fd < 0)
+            return nullptr;
+        char *data = nullptr;
+        struct stat st{};
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *address = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED) {
+                data = static_cast<char *>(address);
+                length = static_cast<size_t>(st.st_size);
+            }
+        }
+        close(fd);
+        return data;
+    }
+
+    void unmap_file(char *data, size_t length) {
+        munmap(data, length);
+    }
+}
+
+#else
+
+namespace SDLExt {
+    char *map_file(const char *, size_t &) {
+        return nullptr;
+    }
+
+    void unmap_file(char *, size_t) {}
+}
+
+#endif
@@ -0,0 +1,23 @@
+//
+// Created by Dogs-Cute on 10/17/2026.
+//
+
+#ifndef SDLCLASS_EXTFILEMAPPING_H
+#define SDLCLASS_EXTFILEMAPPING_H
+
+#include <cstddef>
+
+/*Memory mapping of files, kept in ExtFileMapping.cpp so the platform headers are not included by SDLExt.h.
+ * Compile ExtFileMapping.cpp along with SDL2_rotozoom.c when FrameArray caches are used*/
+namespace SDLExt {
+/**
+ * Map a file privately, so the memory may be written without touching the file.
+ * \param file the path of the file
+ * \param length receives the size of the file
+ * \return the memory, or nullptr if the file cannot be mapped or the platform has no memory mapping*/
+    char *map_file(const char *file, size_t &length);
+
+    void unmap_file(char *data, size_t length);
+}
+
+#endif //SDLCLASS_EXTFILEMAPPING_H
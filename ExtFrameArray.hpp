@@ -6,8 +6,18 @@
 #define SDLCLASS_TEST_EXTFRAMEARRAY_HPP
 
 #include <utility>
+#include <thread>
+#include <future>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <cstring>
 
 #include "ExtBase.h"
+#include "ExtAtlas.hpp"
+#include "ExtFileMapping.h"
 
 NS_BEGIN
 
@@ -17,26 +27,403 @@ NS_BEGIN
         using PointRef = const Point &;
         using FrameVector = std::shared_ptr<std::vector<std::shared_ptr<Surface>>>;
         using SurfaceProcessor = std::function<void(const std::shared_ptr<Surface> &)>;
+        using ReadyCallback = std::function<void(const std::shared_ptr<FrameArray> &)>;
+        using RegionVector = std::shared_ptr<std::vector<Atlas::Region>>;
         FrameVector frames;
+        std::shared_ptr<Atlas> atlas;
+        RegionVector regions;
         size_t counter = 0, delay, index;
         int times = -1;
         bool paused = false;
 
+        /*The threads shared by all the loadings, started on the first use and joined when the program exits*/
+        class WorkerPool {
+        protected:
+            std::mutex mutex;
+            std::condition_variable ready;
+            std::deque<std::function<void()>> jobs;
+            std::vector<std::thread> threads;
+            bool stopping = false;
+
+            WorkerPool() {
+                // The thread posting the jobs works too, except for async loadings
+                size_t count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+                for (size_t i = 0; i < count; i++)
+                    threads.emplace_back([this]() { run(); });
+            }
+
+            void run() {
+                for (;;) {
+                    std::function<void()> job;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        ready.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                        if (jobs.empty())
+                            return;
+                        job = std::move(jobs.front());
+                        jobs.pop_front();
+                    }
+                    job();
+                }
+            }
+
+        public:
+            ~WorkerPool() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stopping = true;
+                }
+                ready.notify_all();
+                for (auto &thread: threads)
+                    thread.join();
+            }
+
+            WorkerPool(const WorkerPool &) = delete;
+
+            WorkerPool &operator=(const WorkerPool &) = delete;
+
+            static WorkerPool &instance() {
+                static WorkerPool pool;
+                return pool;
+            }
+
+            [[nodiscard]] size_t size() const noexcept {
+                return threads.size();
+            }
+
+            void post(std::function<void()> job) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    jobs.push_back(std::move(job));
+                }
+                ready.notify_one();
+            }
+        };
+
+/* Call func(i) for every i in [0, count) on the calling thread and the pool, rethrowing the first exception.
+ * The caller never waits for a pool thread that has not started, so busy pools and nested calls cannot deadlock*/
+        template<typename Func>
+        static void parallel_for(size_t count, const Func &func) {
+            struct State {
+                std::atomic<size_t> next{0};
+                size_t count = 0, active = 0;
+                const Func *func = nullptr;
+                std::mutex mutex;
+                std::condition_variable done;
+                std::exception_ptr error;
+
+                void work() {
+                    for (size_t i; (i = next++) < count;) {
+                        try {
+                            (*func)(i);
+                        } catch (...) {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            if (!error)
+                                error = std::current_exception();
+                        }
+                    }
+                }
+            };
+            auto state = std::make_shared<State>();
+            state->count = count;
+            state->func = &func;
+            auto &pool = WorkerPool::instance();
+            size_t helpers = std::min(pool.size(), count > 0 ? count - 1 : 0);
+            for (size_t i = 0; i < helpers; i++)
+                pool.post([state]() {
+                    {
+                        // Once all the indices are taken, func may be gone with the caller
+                        std::lock_guard<std::mutex> lock(state->mutex);
+                        if (state->next >= state->count)
+                            return;
+                        state->active++;
+                    }
+                    state->work();
+                    {
+                        std::lock_guard<std::mutex> lock(state->mutex);
+                        state->active--;
+                    }
+                    state->done.notify_all();
+                });
+            state->work();
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->done.wait(lock, [&]() { return state->active == 0; });
+            if (state->error)
+                std::rethrow_exception(state->error);
+        }
+
+        template<typename Result, typename Func>
+        static std::future<Result> run_async(Func func) {
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::move(func));
+            auto future = task->get_future();
+            WorkerPool::instance().post([task]() { (*task)(); });
+            return future;
+        }
+
+        // IMG_Init is not thread safe and SDL_image may call it from its loaders, so it is called once before decoding
+        static void init_image_formats(const std::vector<std::filesystem::path> &paths) {
+            static std::mutex mutex;
+            int flags = 0;
+            for (const auto &path: paths) {
+                auto extension = path.extension().string();
+                std::transform(extension.begin(), extension.end(), extension.begin(),
+                               [](unsigned char c) { return std::tolower(c); });
+                if (extension == ".png")
+                    flags |= IMG_INIT_PNG;
+                else if (extension == ".jpg" || extension == ".jpeg")
+                    flags |= IMG_INIT_JPG;
+                else if (extension == ".tif" || extension == ".tiff")
+                    flags |= IMG_INIT_TIF;
+                else if (extension == ".webp")
+                    flags |= IMG_INIT_WEBP;
+            }
+            if (flags != 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                IMG_Init(flags);
+            }
+        }
+
+        static void process_frames(const FrameVector &frames, const SurfaceProcessor *processor) {
+            if (processor)
+                parallel_for(frames->size(), [&](size_t i) { (*processor)(frames->at(i)); });
+        }
+
+        // Decode the files on the worker pool, keeping the order of paths
+        static FrameVector frames_from_paths(const std::vector<std::filesystem::path> &paths,
+                                             const SurfaceProcessor *processor) {
+            init_image_formats(paths);
+            FrameVector frames = std::make_shared<std::vector<std::shared_ptr<Surface>>>(paths.size());
+            parallel_for(paths.size(), [&](size_t i) {
+                auto surface = std::make_shared<Surface>(paths[i].string());
+                if (processor)
+                    (*processor)(surface);
+                (*frames)[i] = surface;
+            });
+            return frames;
+        }
+
+        static std::vector<std::filesystem::path> paths_from_dir(const std::filesystem::path &src,
+                                                                 const std::string &suffix) {
+            std::vector<std::filesystem::path> paths;
+            for (const auto &entry: std::filesystem::directory_iterator(src)) {
+                if (entry.path().extension() == suffix)
+                    paths.push_back(entry.path());
+            }
+            if (paths.empty())
+                throw std::runtime_error("No frames available found in directory: " + src.string());
+            std::sort(paths.begin(), paths.end());
+            return paths;
+        }
+
+/* Load the files with the suffix in the directory, sorted by the file name.
+ * The processor is called from the loading threads, so it must be thread safe*/
         static FrameVector frames_from_dir(const std::filesystem::path &src, const std::string &suffix,
                                            const SurfaceProcessor *processor = nullptr) {
+            return frames_from_paths(paths_from_dir(src, suffix), processor);
+        }
+
+        /*Layout of a frame cache file : CacheHeader, CacheEntry[count], then the pixels of each entry*/
+        struct CacheHeader {
+            char magic[8];
+            Uint32 version, count;
+            Sint64 dir_time, newest_time;
+            Uint64 suffix_hash;
+        };
+
+        struct CacheEntry {
+            Uint32 format;
+            Sint32 w, h, pitch, depth;
+            Uint64 offset;
+        };
+
+        static constexpr char cache_magic[8] = "SDLFRMC";
+        static constexpr Uint32 cache_version = 1;
+        static constexpr Uint64 cache_align = 16;
+
+        // The file is mapped privately, so the surfaces may be modified without touching the file.
+        // It is read into memory where it cannot be mapped
+        class CacheMapping {
+        protected:
+            char *data = nullptr;
+            size_t length = 0;
+            bool mapped = false;
+            std::vector<char> buffer;
+        public:
+            explicit CacheMapping(const std::filesystem::path &file) {
+                data = map_file(file.string().c_str(), length);
+                if (data != nullptr) {
+                    mapped = true;
+                    return;
+                }
+                std::ifstream stream(file, std::ios::binary | std::ios::ate);
+                if (!stream)
+                    return;
+                buffer.resize(static_cast<size_t>(stream.tellg()));
+                stream.seekg(0);
+                if (stream.read(buffer.data(), static_cast<std::streamsize>(buffer.size()))) {
+                    data = buffer.data();
+                    length = buffer.size();
+                }
+            }
+
+            ~CacheMapping() {
+                if (mapped)
+                    unmap_file(data, length);
+            }
+
+            CacheMapping(const CacheMapping &) = delete;
+
+            CacheMapping &operator=(const CacheMapping &) = delete;
+
+            [[nodiscard]] char *ptr() const noexcept {
+                return data;
+            }
+
+            [[nodiscard]] size_t size() const noexcept {
+                return length;
+            }
+        };
+
+        static CacheHeader cache_header(const std::filesystem::path &src, const std::string &suffix,
+                                        const std::vector<std::filesystem::path> &paths) {
+            CacheHeader header{};
+            std::copy(std::begin(cache_magic), std::end(cache_magic), header.magic);
+            header.version = cache_version;
+            header.count = static_cast<Uint32>(paths.size());
+            header.dir_time = std::filesystem::last_write_time(src).time_since_epoch().count();
+            header.newest_time = min_of(Sint64);
+            for (const auto &path: paths)
+                header.newest_time = std::max<Sint64>(header.newest_time,
+                                                      std::filesystem::last_write_time(path).time_since_epoch().count());
+            header.suffix_hash = std::hash<std::string>()(suffix);
+            return header;
+        }
+
+        // Whether the surface of the entry is a format SDL can read, and lies inside the file
+        static bool valid_entry(const CacheEntry &entry, size_t length) noexcept {
+            // Palettes are not stored, and FOURCC formats have no fixed layout
+            if (entry.format == SDL_PIXELFORMAT_UNKNOWN || SDL_ISPIXELFORMAT_FOURCC(entry.format) ||
+                SDL_ISPIXELFORMAT_INDEXED(entry.format) ||
+                entry.depth != static_cast<Sint32>(SDL_BITSPERPIXEL(entry.format)))
+                return false;
+            if (entry.w <= 0 || entry.h <= 0 || entry.pitch <= 0 ||
+                static_cast<Uint64>(entry.pitch) < static_cast<Uint64>(entry.w) * SDL_BYTESPERPIXEL(entry.format))
+                return false;
+            return entry.offset <= length && static_cast<Uint64>(entry.pitch) * entry.h <= length - entry.offset;
+        }
+
+        // Return nullptr if the cache is missing, broken or out of date
+        static FrameVector frames_from_cache(const std::filesystem::path &cache, const CacheHeader &expected) {
+            auto mapping = std::make_shared<CacheMapping>(cache);
+            auto data = mapping->ptr();
+            size_t length = mapping->size();
+            if (data == nullptr || length < sizeof(CacheHeader))
+                return nullptr;
+            CacheHeader header;
+            std::memcpy(&header, data, sizeof(CacheHeader));
+            if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+                header.version != expected.version || header.count != expected.count ||
+                header.dir_time != expected.dir_time || header.newest_time != expected.newest_time ||
+                header.suffix_hash != expected.suffix_hash ||
+                length < sizeof(CacheHeader) + sizeof(CacheEntry) * header.count)
+                return nullptr;
+
             FrameVector frames = std::make_shared<std::vector<std::shared_ptr<Surface>>>();
-            size_t count = 0;
-            for (const auto &entry: std::filesystem::directory_iterator(src)) {
-                if (entry.path().extension() == suffix) {
-                    auto surface = std::make_shared<Surface>(entry.path().string());
-                    if (processor)
-                        (*processor)(surface);
-                    frames->push_back(surface);
-                    count++;
+            frames->reserve(header.count);
+            for (Uint32 i = 0; i < header.count; i++) {
+                CacheEntry entry;
+                std::memcpy(&entry, data + sizeof(CacheHeader) + sizeof(CacheEntry) * i, sizeof(CacheEntry));
+                if (!valid_entry(entry, length))
+                    return nullptr;
+                auto surface = SDL_CreateRGBSurfaceWithFormatFrom(data + entry.offset, entry.w, entry.h, entry.depth,
+                                                                  entry.pitch, entry.format);
+                if (surface == nullptr)
+                    return nullptr;
+                frames->push_back(std::shared_ptr<Surface>(new Surface(surface), [mapping](Surface *frame) {
+                    delete frame;
+                }));
+            }
+            return frames;
+        }
+
+        // Write to a temporary file first, so that a broken cache is never left behind
+        static void write_cache(const std::filesystem::path &cache, const CacheHeader &header,
+                                const FrameVector &frames) {
+            std::vector<CacheEntry> entries;
+            std::vector<SDLSurfacePtr> surfaces;
+            Uint64 offset = sizeof(CacheHeader) + sizeof(CacheEntry) * frames->size();
+            for (const auto &frame: *frames) {
+                SDLSurfacePtr surface = *frame;
+                // Palettes are not stored, so paletted frames are cached as ARGB8888
+                if (surface->format->palette != nullptr)
+                    surface = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+                else
+                    surface->refcount++;
+                if (surface == nullptr)
+                    break;
+                offset = (offset + cache_align - 1) / cache_align * cache_align;
+                // The padding before offset is written too, so it is zeroed rather than left uninitialized
+                CacheEntry entry;
+                std::memset(&entry, 0, sizeof(CacheEntry));
+                entry.format = surface->format->format;
+                entry.w = surface->w;
+                entry.h = surface->h;
+                entry.pitch = surface->pitch;
+                entry.depth = surface->format->BitsPerPixel;
+                entry.offset = offset;
+                entries.push_back(entry);
+                surfaces.push_back(surface);
+                offset += static_cast<Uint64>(surface->pitch) * surface->h;
+            }
+
+            if (surfaces.size() == frames->size()) {
+                auto temp = cache;
+                temp += ".tmp";
+                bool written;
+                {
+                    std::ofstream stream(temp, std::ios::binary | std::ios::trunc);
+                    stream.write(reinterpret_cast<const char *>(&header), sizeof(CacheHeader));
+                    stream.write(reinterpret_cast<const char *>(entries.data()),
+                                 static_cast<std::streamsize>(sizeof(CacheEntry) * entries.size()));
+                    for (size_t i = 0; i < surfaces.size() && stream; i++) {
+                        auto surface = surfaces[i];
+                        std::streamoff padding = static_cast<std::streamoff>(entries[i].offset) - stream.tellp();
+                        for (; padding > 0; padding--)
+                            stream.put(0);
+                        if (SDL_MUSTLOCK(surface))
+                            SDL_LockSurface(surface);
+                        stream.write(static_cast<const char *>(surface->pixels),
+                                     static_cast<std::streamsize>(surface->pitch) * surface->h);
+                        if (SDL_MUSTLOCK(surface))
+                            SDL_UnlockSurface(surface);
+                    }
+                    // A short write, such as on a full disk, must not be renamed into place
+                    stream.close();
+                    written = !stream.fail();
                 }
+                std::error_code error;
+                if (written)
+                    std::filesystem::rename(temp, cache, error);
+                if (!written || error)
+                    std::filesystem::remove(temp, error);
             }
-            if (count == 0)
-                throw std::runtime_error("No frames available found in directory: " + src.string());
+            for (auto surface: surfaces)
+                SDL_FreeSurface(surface);
+        }
+
+/* Load the frames from the cache file if it matches the directory, otherwise decode them and rewrite the cache.
+ * The cache keeps the frames before processing, the processor is always applied after loading*/
+        static FrameVector frames_from_dir_cached(const std::filesystem::path &src, const std::string &suffix,
+                                                  const std::filesystem::path &cache,
+                                                  const SurfaceProcessor *processor = nullptr) {
+            auto paths = paths_from_dir(src, suffix);
+            auto header = cache_header(src, suffix, paths);
+            auto frames = frames_from_cache(cache, header);
+            if (!frames) {
+                frames = frames_from_paths(paths, nullptr);
+                write_cache(cache, header, frames);
+            }
+            process_frames(frames, processor);
             return frames;
         }
 
@@ -45,7 +432,23 @@ NS_BEGIN
 
         [[nodiscard]] FrameArray deepcopy() const {
             FrameVector new_frames = std::make_shared<std::vector<std::shared_ptr<Surface>>>(*frames);
-            return FrameArray{new_frames, delay, index};
+            FrameArray result{new_frames, delay, index};
+            result.atlas = atlas;
+            result.regions = regions;
+            return result;
+        }
+
+/**
+ * Pack all the frames into the atlas, so that they are copied from the atlas pages instead of their own textures.
+ Frame arrays sharing the same frames(like deepcopy()) share the packed regions.
+ * \param atlas the atlas to pack into, kept alive by the frame array*/
+        void pack(const std::shared_ptr<Atlas> &new_atlas) {
+            auto new_regions = std::make_shared<std::vector<Atlas::Region>>();
+            new_regions->reserve(frames->size());
+            for (const auto &frame: *frames)
+                new_regions->push_back(new_atlas->insert(*frame));
+            atlas = new_atlas;
+            regions = new_regions;
         }
 
         static FrameArray
@@ -70,6 +473,82 @@ NS_BEGIN
             return std::make_shared<FrameArray>(frames_from_dir(src, suffix, &processor), delay, index);
         }
 
+/**
+ * Load the frames like from_dir(), but keep the decoded pixels in a cache file.
+ When the directory and its newest frame are not modified since the cache is written, the frames are mapped from the cache instead of decoded.
+ * \param cache the path of the cache file*/
+        static FrameArray
+        from_dir_cached(const std::filesystem::path &src, const std::string &suffix,
+                        const std::filesystem::path &cache, size_t delay = 1, size_t index = 0) {
+            return FrameArray{frames_from_dir_cached(src, suffix, cache), delay, index};
+        }
+
+        static std::shared_ptr<FrameArray>
+        ptr_from_dir_cached(const std::filesystem::path &src, const std::string &suffix,
+                            const std::filesystem::path &cache, size_t delay = 1, size_t index = 0) {
+            return std::make_shared<FrameArray>(frames_from_dir_cached(src, suffix, cache), delay, index);
+        }
+
+        static FrameArray
+        from_dir_cached(const std::filesystem::path &src, const std::string &suffix,
+                        const std::filesystem::path &cache, const SurfaceProcessor &processor,
+                        size_t delay = 1, size_t index = 0) {
+            return FrameArray{frames_from_dir_cached(src, suffix, cache, &processor), delay, index};
+        }
+
+        static std::shared_ptr<FrameArray>
+        ptr_from_dir_cached(const std::filesystem::path &src, const std::string &suffix,
+                            const std::filesystem::path &cache, const SurfaceProcessor &processor,
+                            size_t delay = 1, size_t index = 0) {
+            return std::make_shared<FrameArray>(frames_from_dir_cached(src, suffix, cache, &processor), delay, index);
+        }
+
+/**
+ * Load the frames on the worker pool, see from_dir().
+ * \attention Destroying the returned future does not stop the loading*/
+        static std::future<FrameArray>
+        from_dir_async(const std::filesystem::path &src, const std::string &suffix, size_t delay = 1,
+                       size_t index = 0) {
+            return run_async<FrameArray>([=]() {
+                return FrameArray{frames_from_dir(src, suffix), delay, index};
+            });
+        }
+
+        static std::future<FrameArray>
+        from_dir_async(const std::filesystem::path &src, const std::string &suffix, const SurfaceProcessor &processor,
+                       size_t delay = 1, size_t index = 0) {
+            return run_async<FrameArray>([=]() {
+                return FrameArray{frames_from_dir(src, suffix, &processor), delay, index};
+            });
+        }
+
+/**
+ * Load the frames on the worker pool, see from_dir().
+ * \param on_ready called from the loading thread once the frames are loaded, before the future is ready. Defaults to \c nullptr
+ * \attention Destroying the returned future does not stop the loading, on_ready is still called*/
+        static std::future<std::shared_ptr<FrameArray>>
+        ptr_from_dir_async(const std::filesystem::path &src, const std::string &suffix,
+                           ReadyCallback on_ready = nullptr, size_t delay = 1, size_t index = 0) {
+            return run_async<std::shared_ptr<FrameArray>>([=]() {
+                auto result = std::make_shared<FrameArray>(frames_from_dir(src, suffix), delay, index);
+                if (on_ready)
+                    on_ready(result);
+                return result;
+            });
+        }
+
+        static std::future<std::shared_ptr<FrameArray>>
+        ptr_from_dir_async(const std::filesystem::path &src, const std::string &suffix,
+                           const SurfaceProcessor &processor, ReadyCallback on_ready = nullptr,
+                           size_t delay = 1, size_t index = 0) {
+            return run_async<std::shared_ptr<FrameArray>>([=]() {
+                auto result = std::make_shared<FrameArray>(frames_from_dir(src, suffix, &processor), delay, index);
+                if (on_ready)
+                    on_ready(result);
+                return result;
+            });
+        }
+
         explicit FrameArray(FrameVector frames, size_t delay = 1, size_t index = 0) :
                 frames(std::move(frames)), delay(delay), index(index) {
             if (delay == 0)
@@ -90,7 +569,10 @@ NS_BEGIN
         bool copy_to(Renderer &renderer, const CopyToType &pos) {
             bool next_ok = false;
             if (!paused && (next_ok = next())) index = (index + 1) % frames->size();
-            frames->at(index)->copy_to(renderer, pos);
+            if (atlas)
+                atlas->copy_to(renderer, regions->at(index), pos);
+            else
+                frames->at(index)->copy_to(renderer, pos);
             return next_ok;
         }
 
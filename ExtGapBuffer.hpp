@@ -0,0 +1,176 @@
+//
+// Created by Dogs-Cute on 10/17/2026.
+//
+
+#ifndef SDLCLASS_EXTGAPBUFFER_HPP
+#define SDLCLASS_EXTGAPBUFFER_HPP
+
+#include <string_view>
+
+#include "ExtBase.h"
+#include "ExtUTF8.hpp"
+
+NS_BEGIN
+/*UTF-8 text edited at a cursor. The free space of the buffer is kept at the cursor,
+ so insertions and deletions at the cursor take amortized O(1), and moving the cursor takes O(distance).*/
+    class GapBuffer final {
+    protected:
+        std::vector<char> buffer;
+        // The gap is [gap_begin, gap_end), the cursor is at gap_begin
+        size_t gap_begin = 0, gap_end = 0;
+        // Increased on every change of the text
+        Uint64 version = 0;
+
+        [[nodiscard]] size_t gap_size() const noexcept {
+            return gap_end - gap_begin;
+        }
+
+        void reserve_gap(size_t length) {
+            if (gap_size() >= length)
+                return;
+            size_t after = buffer.size() - gap_end;
+            size_t capacity = std::max(buffer.size() * 2, buffer.size() - gap_size() + length + 16);
+            std::vector<char> result(capacity);
+            std::copy_n(buffer.begin(), gap_begin, result.begin());
+            std::copy_n(buffer.begin() + static_cast<std::ptrdiff_t>(gap_end), after,
+                        result.end() - static_cast<std::ptrdiff_t>(after));
+            gap_end = capacity - after;
+            buffer = std::move(result);
+        }
+
+    public:
+        explicit GapBuffer(std::string_view text = {}) {
+            insert(text);
+            version = 0;
+        }
+
+        /*The length of the text in bytes*/
+        [[nodiscard]] size_t size() const noexcept {
+            return buffer.size() - gap_size();
+        }
+
+        [[nodiscard]] bool empty() const noexcept {
+            return size() == 0;
+        }
+
+        /*The byte index of the cursor in the text*/
+        [[nodiscard]] size_t cursor() const noexcept {
+            return gap_begin;
+        }
+
+        [[nodiscard]] Uint64 get_version() const noexcept {
+            return version;
+        }
+
+        char operator[](size_t index) const noexcept {
+            return index < gap_begin ? buffer[index] : buffer[index + gap_size()];
+        }
+
+        /*The text before the cursor*/
+        [[nodiscard]] std::string_view before() const noexcept {
+            return {buffer.data(), gap_begin};
+        }
+
+        /*The text after the cursor*/
+        [[nodiscard]] std::string_view after() const noexcept {
+            return {buffer.data() + gap_end, buffer.size() - gap_end};
+        }
+
+        [[nodiscard]] std::string str() const {
+            std::string result;
+            copy_to(result);
+            return result;
+        }
+
+        /*Copy the text to result, reusing its storage*/
+        void copy_to(std::string &result) const {
+            result.assign(before());
+            result.append(after());
+        }
+
+        /*Move the cursor to the byte index, clamped to the text*/
+        void move_to(size_t index) noexcept {
+            index = std::min(index, size());
+            if (index < gap_begin) {
+                size_t length = gap_begin - index;
+                std::copy_backward(buffer.begin() + static_cast<std::ptrdiff_t>(index),
+                                   buffer.begin() + static_cast<std::ptrdiff_t>(gap_begin),
+                                   buffer.begin() + static_cast<std::ptrdiff_t>(gap_end));
+                gap_begin -= length;
+                gap_end -= length;
+            } else if (index > gap_begin) {
+                size_t length = index - gap_begin;
+                std::copy_n(buffer.begin() + static_cast<std::ptrdiff_t>(gap_end), length,
+                            buffer.begin() + static_cast<std::ptrdiff_t>(gap_begin));
+                gap_begin += length;
+                gap_end += length;
+            }
+        }
+
+        /*Move the cursor to the previous code point, return whether it moved*/
+        bool left() noexcept {
+            if (gap_begin == 0)
+                return false;
+            move_to(UTF8::prev(before(), gap_begin));
+            return true;
+        }
+
+        /*Move the cursor to the next code point, return whether it moved*/
+        bool right() noexcept {
+            if (gap_end == buffer.size())
+                return false;
+            move_to(gap_begin + UTF8::next(after(), 0));
+            return true;
+        }
+
+        void home() noexcept {
+            move_to(0);
+        }
+
+        void end() noexcept {
+            move_to(size());
+        }
+
+        /*Insert text at the cursor and move the cursor after it*/
+        void insert(std::string_view text) {
+            if (text.empty())
+                return;
+            reserve_gap(text.size());
+            std::copy(text.begin(), text.end(), buffer.begin() + static_cast<std::ptrdiff_t>(gap_begin));
+            gap_begin += text.size();
+            version++;
+        }
+
+        void insert(char c) {
+            insert(std::string_view(&c, 1));
+        }
+
+        /*Erase the code point before the cursor, as backspace does. Return the bytes erased*/
+        size_t erase_before() noexcept {
+            if (gap_begin == 0)
+                return 0;
+            size_t length = gap_begin - UTF8::prev(before(), gap_begin);
+            gap_begin -= length;
+            version++;
+            return length;
+        }
+
+        /*Erase the code point after the cursor, as delete does. Return the bytes erased*/
+        size_t erase_after() noexcept {
+            if (gap_end == buffer.size())
+                return 0;
+            size_t length = UTF8::next(after(), 0);
+            gap_end += length;
+            version++;
+            return length;
+        }
+
+        void clear() noexcept {
+            gap_begin = 0;
+            gap_end = buffer.size();
+            version++;
+        }
+    };
+NS_END
+
+#endif //SDLCLASS_EXTGAPBUFFER_HPP
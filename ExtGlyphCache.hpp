@@ -0,0 +1,132 @@
+//
+// Created by Dogs-Cute on 10/17/2026.
+//
+
+#ifndef SDLCLASS_EXTGLYPHCACHE_HPP
+#define SDLCLASS_EXTGLYPHCACHE_HPP
+
+#include "ExtBase.h"
+#include "ExtAtlas.hpp"
+#include "ExtUTF8.hpp"
+
+NS_BEGIN
+/*Renders text by copying glyphs cached in an atlas, each glyph of a style is rasterized only once*/
+    class GlyphCache final {
+    public:
+        struct Glyph {
+            Atlas::Region region;
+            int advance;
+            bool visible;
+        };
+
+    protected:
+        using PointRef = const Point &;
+        Font &font;
+        Atlas atlas;
+        std::unordered_map<Uint64, Glyph> glyphs;
+
+        [[nodiscard]] Uint64 glyph_key(Uint32 codepoint) const {
+            return codepoint | static_cast<Uint64>(font.get_style()) << 32 |
+                   static_cast<Uint64>(font.get_outline()) << 40;
+        }
+
+        // The width of the word starting at index, which ends at a space or a line break
+        int word_width(std::string_view text, size_t index) {
+            int width = 0;
+            while (index < text.size() && text[index] != ' ' && text[index] != '\n')
+                width += glyph(UTF8::decode(text, index)).advance;
+            return width;
+        }
+
+/* Lay out the text, calling func(glyph, position) for every glyph, and return the size of the text.
+ * Lines are broken at line breaks, and at spaces before words exceeding wrap_length if it is positive*/
+        template<typename Func>
+        Point layout(std::string_view text, int wrap_length, const Func &func) {
+            int line_skip = font.line_skip(), width = 0;
+            Point pen;
+            Uint32 prev = 0;
+            auto new_line = [&]() {
+                width = std::max(width, pen.x);
+                pen = {0, pen.y + line_skip};
+                prev = 0;
+            };
+            for (size_t i = 0; i < text.size();) {
+                if (text[i] == '\n') {
+                    new_line();
+                    i++;
+                    continue;
+                }
+                if (wrap_length > 0 && pen.x > 0 && text[i] != ' ' && text[i - 1] == ' ' &&
+                    pen.x + word_width(text, i) > wrap_length)
+                    new_line();
+                Uint32 codepoint = UTF8::decode(text, i);
+                if (prev != 0)
+                    pen.x += TTF_GetFontKerningSizeGlyphs32(font.ptr(), prev, codepoint);
+                const auto &cur = glyph(codepoint);
+                func(cur, pen);
+                pen.x += cur.advance;
+                prev = codepoint;
+            }
+            return {std::max(width, pen.x), pen.y + font.height()};
+        }
+
+    public:
+/**
+ * \param font the font to rasterize glyphs with, glyphs are cached separately for each style and outline
+ * \param page_size the size of the atlas pages. Defaults to 512x512*/
+        explicit GlyphCache(Font &font, const Point &page_size = {512, 512}) : font(font), atlas(page_size) {}
+
+        GlyphCache(const GlyphCache &) = delete;
+
+        GlyphCache &operator=(const GlyphCache &) = delete;
+
+        /*Get the glyph of the current font style, rasterizing it on the first use*/
+        const Glyph &glyph(Uint32 codepoint) {
+            auto key = glyph_key(codepoint);
+            auto iter = glyphs.find(key);
+            if (iter != glyphs.end())
+                return iter->second;
+            Glyph result{{}, 0, false};
+            TTF_GlyphMetrics32(font.ptr(), codepoint, nullptr, nullptr, nullptr, nullptr, &result.advance);
+            Surface surface{font.render_glyph(codepoint, {255, 255, 255, 255})};
+            if (surface.ptr() != nullptr && surface.w() > 0 && surface.h() > 0) {
+                result.region = atlas.insert(surface);
+                result.visible = true;
+            }
+            return glyphs.insert({key, result}).first->second;
+        }
+
+        /*The size of the text as copy_to() would draw it*/
+        Point size(std::string_view text, int wrap_length = 0) {
+            return layout(text, wrap_length, [](const Glyph &, PointRef) {});
+        }
+
+/**
+ * Copy the text to the renderer.
+ * \param text the UTF-8 text
+ * \param color the color of the text
+ * \param pos the left-up position of the text
+ * \param wrap_length the width to wrap the text at, not wrapping if 0. Defaults to 0
+ * \return the size of the text*/
+        Point copy_to(Renderer &renderer, std::string_view text, const SDL_Color &color, PointRef pos,
+                      int wrap_length = 0) {
+            // Rasterize the missing glyphs first, so the pages are uploaded once before copying
+            layout(text, wrap_length, [](const Glyph &, PointRef) {});
+            atlas.upload(renderer);
+            for (size_t page = 0; page < atlas.page_count(); page++)
+                atlas.texture(page).set_color(color);
+            return layout(text, wrap_length, [&](const Glyph &cur, PointRef glyph_pos) {
+                if (cur.visible)
+                    atlas.copy_to(renderer, cur.region, pos + glyph_pos);
+            });
+        }
+
+        /*Drop all the cached glyphs*/
+        void clear() noexcept {
+            glyphs.clear();
+            atlas.clear();
+        }
+    };
+NS_END
+
+#endif //SDLCLASS_EXTGLYPHCACHE_HPP
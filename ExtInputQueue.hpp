@@ -0,0 +1,203 @@
+//
+// Created by Dogs-Cute on 10/17/2026.
+//
+
+#ifndef SDLCLASS_EXTINPUTQUEUE_HPP
+#define SDLCLASS_EXTINPUTQUEUE_HPP
+
+#include <array>
+
+#include "ExtBase.h"
+#include "ExtKeyMgr.hpp"
+
+NS_BEGIN
+    /*Whether the event is an input event kept by InputQueue and fed to managers*/
+    constexpr bool is_input_event(Uint32 type) noexcept {
+        switch (type) {
+            case SDL_KEYDOWN:
+            case SDL_KEYUP:
+            case SDL_TEXTEDITING:
+            case SDL_TEXTINPUT:
+            case SDL_MOUSEMOTION:
+            case SDL_MOUSEBUTTONDOWN:
+            case SDL_MOUSEBUTTONUP:
+            case SDL_MOUSEWHEEL:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+/**
+ * Give an input event to a manager, calling down(), up(), text_input() and so on.
+ * \attention record() should be called before and refresh() after, as for events given by hand*/
+    template<typename KeyType>
+    void feed(KeyClickMgr<KeyType> &mgr, const SDL_Event &event) {
+        switch (event.type) {
+            case SDL_KEYDOWN:
+                mgr.down(static_cast<KeyType>(event.key.keysym.sym));
+                break;
+            case SDL_KEYUP:
+                mgr.up(static_cast<KeyType>(event.key.keysym.sym));
+                break;
+            case SDL_TEXTINPUT:
+                mgr.text_input(event.text);
+                break;
+            case SDL_TEXTEDITING:
+                mgr.text_editing(event.edit);
+                break;
+            default:
+                break;
+        }
+    }
+
+    inline void feed(MouseMgr &mgr, const SDL_Event &event) {
+        switch (event.type) {
+            case SDL_MOUSEMOTION:
+                mgr.motion(event.motion);
+                break;
+            case SDL_MOUSEBUTTONDOWN:
+                mgr.down(event.button);
+                break;
+            case SDL_MOUSEBUTTONUP:
+                mgr.up(event.button);
+                break;
+            case SDL_MOUSEWHEEL:
+                mgr.wheel_motion(event.wheel);
+                break;
+            default:
+                break;
+        }
+    }
+
+    template<typename KeyType>
+    void feed(MouseAndKeyClickMgr<KeyType> &mgr, const SDL_Event &event) {
+        feed(static_cast<KeyClickMgr<KeyType> &>(mgr), event);
+        feed(mgr.mouse, event);
+    }
+
+/*A lock-free queue of input events, written by one thread and read by another.
+ * The events keep their SDL timestamps, so they are consumed in order, and may be consumed up to a time only.
+ * With attach(), the events are pushed by an SDL event watch as soon as SDL receives them;
+ the main loop still has to pump the events, SDL_PollEvent() for example.*/
+    template<size_t capacity = 1024>
+    class InputQueue final {
+        static_assert(capacity != 0 && (capacity & (capacity - 1)) == 0, "The capacity must be a power of 2");
+    protected:
+        std::array<SDL_Event, capacity> events;
+        // The next event to read, written by the consumer only
+        alignas(64) std::atomic<size_t> head{0};
+        // The next event to write, written by the producer only
+        alignas(64) std::atomic<size_t> tail{0};
+        std::atomic<size_t> dropped{0};
+
+        static int SDLCALL watch(void *queue, SDL_Event *event) {
+            if (is_input_event(event->type))
+                static_cast<InputQueue *>(queue)->push(*event);
+            return 0;
+        }
+
+    public:
+        InputQueue() = default;
+
+        ~InputQueue() {
+            detach();
+        }
+
+        InputQueue(const InputQueue &) = delete;
+
+        InputQueue &operator=(const InputQueue &) = delete;
+
+        void attach() {
+            SDL_AddEventWatch(watch, this);
+        }
+
+        void detach() {
+            SDL_DelEventWatch(watch, this);
+        }
+
+        /*Called by the producer. Return false and count the event as dropped if the queue is full*/
+        bool push(const SDL_Event &event) noexcept {
+            auto cur_tail = tail.load(std::memory_order_relaxed);
+            if (cur_tail - head.load(std::memory_order_acquire) == capacity) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            events[cur_tail & (capacity - 1)] = event;
+            tail.store(cur_tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /*Called by the consumer. The oldest event, or nullptr if the queue is empty*/
+        [[nodiscard]] const SDL_Event *peek() const noexcept {
+            auto cur_head = head.load(std::memory_order_relaxed);
+            if (cur_head == tail.load(std::memory_order_acquire))
+                return nullptr;
+            return &events[cur_head & (capacity - 1)];
+        }
+
+        /*Called by the consumer. Move the oldest event to event, return false if the queue is empty*/
+        bool pop(SDL_Event &event) noexcept {
+            auto front = peek();
+            if (front == nullptr)
+                return false;
+            event = *front;
+            head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            return true;
+        }
+
+        [[nodiscard]] size_t size() const noexcept {
+            return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+        }
+
+        [[nodiscard]] bool empty() const noexcept {
+            return size() == 0;
+        }
+
+        /*The number of events lost because the queue was full*/
+        [[nodiscard]] size_t get_dropped() const noexcept {
+            return dropped.load(std::memory_order_relaxed);
+        }
+
+/**
+ * Feed the events up to a time to the manager, as one frame of input.
+ * \param mgr the manager, whose record() and refresh() are left to the caller
+ * \param until the last SDL timestamp to consume, in milliseconds. Defaults to all the events
+ * \return the number of events consumed*/
+        template<typename MgrType>
+        size_t dispatch(MgrType &mgr, Uint32 until = max_of(Uint32)) {
+            size_t count = 0;
+            SDL_Event event;
+            for (auto front = peek(); front != nullptr && front->common.timestamp <= until; front = peek()) {
+                pop(event);
+                feed(mgr, event);
+                count++;
+            }
+            return count;
+        }
+
+/**
+ * Feed the events up to a time to the manager one at a time, so no transition is collapsed with another.
+ Every event is wrapped by record() and refresh(), then func(event) is called, processing widgets for example.
+ * \param mgr the manager
+ * \param func the function called after every event
+ * \param until the last SDL timestamp to consume, in milliseconds. Defaults to all the events
+ * \return the number of events consumed*/
+        template<typename MgrType, typename Func>
+        size_t replay(MgrType &mgr, const Func &func, Uint32 until = max_of(Uint32)) {
+            size_t count = 0;
+            SDL_Event event;
+            for (auto front = peek(); front != nullptr && front->common.timestamp <= until; front = peek()) {
+                pop(event);
+                mgr.record();
+                feed(mgr, event);
+                mgr.refresh();
+                func(static_cast<const SDL_Event &>(event));
+                count++;
+            }
+            return count;
+        }
+    };
+NS_END
+
+#endif //SDLCLASS_EXTINPUTQUEUE_HPP
@@ -0,0 +1,373 @@
+//
+// Created by Dogs-Cute on 10/17/2026.
+//
+
+#ifndef SDLCLASS_EXTINPUTREPLAY_HPP
+#define SDLCLASS_EXTINPUTREPLAY_HPP
+
+#include <cstring>
+#include <fstream>
+
+#include "ExtBase.h"
+#include "ExtKeyMgr.hpp"
+#include "ExtInputQueue.hpp"
+#include "ExtWidget.hpp"
+
+NS_BEGIN
+/*Layout of an input log : the magic and the version, then records of a kind byte and its payload.
+ * Integers are little endian. A frame_end record closes every frame*/
+    namespace InputLogFormat {
+        constexpr char magic[8] = "SDLEINP";
+        constexpr Uint32 version = 1;
+
+        enum Kind : Uint8 {
+            frame_end,
+            key_down,       // Sint32 sym
+            key_up,         // Sint32 sym
+            button_down,    // Uint8 button, Sint32 x, y
+            button_up,      // Uint8 button, Sint32 x, y
+            motion,         // Sint32 x, y, xrel, yrel
+            wheel,          // Sint32 x, y, float precise_x, precise_y
+            text_input,     // Uint8 length, then the UTF-8 text
+            text_editing    // Uint8 length, then the UTF-8 text, Sint32 start
+        };
+    }
+
+/*Serializes the input events of every frame into a compact binary log, see InputLogFormat*/
+    class InputRecorder final {
+    protected:
+        std::vector<Uint8> data;
+        size_t frames = 0;
+
+        void put(Uint8 byte) {
+            data.push_back(byte);
+        }
+
+        void put32(Uint32 value) {
+            for (int i = 0; i < 4; i++)
+                data.push_back(static_cast<Uint8>(value >> (i * 8)));
+        }
+
+        void put_float(float value) {
+            Uint32 bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            put32(bits);
+        }
+
+        void put_text(const char *text, size_t capacity) {
+            auto length = static_cast<Uint8>(strnlen(text, capacity));
+            put(length);
+            data.insert(data.end(), text, text + length);
+        }
+
+    public:
+        InputRecorder() {
+            data.insert(data.end(), InputLogFormat::magic, InputLogFormat::magic + sizeof(InputLogFormat::magic));
+            put32(InputLogFormat::version);
+        }
+
+        /*Record an input event of the current frame, other events are ignored*/
+        void record(const SDL_Event &event) {
+            using namespace InputLogFormat;
+            switch (event.type) {
+                case SDL_KEYDOWN:
+                case SDL_KEYUP:
+                    put(event.type == SDL_KEYDOWN ? key_down : key_up);
+                    put32(static_cast<Uint32>(event.key.keysym.sym));
+                    break;
+                case SDL_MOUSEBUTTONDOWN:
+                case SDL_MOUSEBUTTONUP:
+                    put(event.type == SDL_MOUSEBUTTONDOWN ? button_down : button_up);
+                    put(event.button.button);
+                    put32(static_cast<Uint32>(event.button.x));
+                    put32(static_cast<Uint32>(event.button.y));
+                    break;
+                case SDL_MOUSEMOTION:
+                    put(motion);
+                    put32(static_cast<Uint32>(event.motion.x));
+                    put32(static_cast<Uint32>(event.motion.y));
+                    put32(static_cast<Uint32>(event.motion.xrel));
+                    put32(static_cast<Uint32>(event.motion.yrel));
+                    break;
+                case SDL_MOUSEWHEEL:
+                    put(wheel);
+                    put32(static_cast<Uint32>(event.wheel.x));
+                    put32(static_cast<Uint32>(event.wheel.y));
+                    put_float(event.wheel.preciseX);
+                    put_float(event.wheel.preciseY);
+                    break;
+                case SDL_TEXTINPUT:
+                    put(text_input);
+                    put_text(event.text.text, sizeof(event.text.text));
+                    break;
+                case SDL_TEXTEDITING:
+                    put(text_editing);
+                    put_text(event.edit.text, sizeof(event.edit.text));
+                    put32(static_cast<Uint32>(event.edit.start));
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        void end_frame() {
+            put(InputLogFormat::frame_end);
+            frames++;
+        }
+
+        [[nodiscard]] size_t frame_count() const noexcept {
+            return frames;
+        }
+
+        [[nodiscard]] const std::vector<Uint8> &bytes() const noexcept {
+            return data;
+        }
+
+        void save(const std::filesystem::path &file) const {
+            std::ofstream stream(file, std::ios::binary | std::ios::trunc);
+            stream.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+            if (!stream)
+                throw std::runtime_error("Cannot write input log: " + file.string());
+        }
+    };
+
+/*The frames of an input log, decoded back to SDL events whose timestamps are the frame indexes*/
+    class InputLog final {
+    protected:
+        std::vector<SDL_Event> events;
+        // The end of the events of each frame
+        std::vector<size_t> frame_ends;
+
+        class Reader {
+        protected:
+            const std::vector<Uint8> &data;
+            size_t index;
+        public:
+            Reader(const std::vector<Uint8> &data, size_t index) : data(data), index(index) {}
+
+            [[nodiscard]] bool done() const noexcept {
+                return index >= data.size();
+            }
+
+            Uint8 get() {
+                if (index >= data.size())
+                    throw std::runtime_error("Input log is truncated");
+                return data[index++];
+            }
+
+            Uint32 get32() {
+                Uint32 value = 0;
+                for (int i = 0; i < 4; i++)
+                    value |= static_cast<Uint32>(get()) << (i * 8);
+                return value;
+            }
+
+            Sint32 get_int() {
+                return static_cast<Sint32>(get32());
+            }
+
+            float get_float() {
+                Uint32 bits = get32();
+                float value;
+                std::memcpy(&value, &bits, sizeof(value));
+                return value;
+            }
+
+            void get_text(char *text, size_t capacity) {
+                size_t length = get();
+                if (length >= capacity)
+                    throw std::runtime_error("Input log has a text too long");
+                for (size_t i = 0; i < length; i++)
+                    text[i] = static_cast<char>(get());
+                text[length] = 0;
+            }
+        };
+
+    public:
+/**
+ * Decode a log written by InputRecorder.
+ * \throw std::runtime_error if the log is not valid*/
+        explicit InputLog(const std::vector<Uint8> &data) {
+            using namespace InputLogFormat;
+            if (data.size() < sizeof(magic) + 4 || std::memcmp(data.data(), magic, sizeof(magic)) != 0)
+                throw std::runtime_error("Not an input log");
+            Reader reader(data, sizeof(magic));
+            if (reader.get32() != version)
+                throw std::runtime_error("Unsupported input log version");
+            while (!reader.done()) {
+                auto kind = reader.get();
+                if (kind == frame_end) {
+                    frame_ends.push_back(events.size());
+                    continue;
+                }
+                SDL_Event event{};
+                event.common.timestamp = static_cast<Uint32>(frame_ends.size());
+                switch (kind) {
+                    case key_down:
+                    case key_up:
+                        event.type = kind == key_down ? SDL_KEYDOWN : SDL_KEYUP;
+                        event.key.keysym.sym = reader.get_int();
+                        break;
+                    case button_down:
+                    case button_up:
+                        event.type = kind == button_down ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP;
+                        event.button.button = reader.get();
+                        event.button.x = reader.get_int();
+                        event.button.y = reader.get_int();
+                        break;
+                    case motion:
+                        event.type = SDL_MOUSEMOTION;
+                        event.motion.x = reader.get_int();
+                        event.motion.y = reader.get_int();
+                        event.motion.xrel = reader.get_int();
+                        event.motion.yrel = reader.get_int();
+                        break;
+                    case wheel:
+                        event.type = SDL_MOUSEWHEEL;
+                        event.wheel.x = reader.get_int();
+                        event.wheel.y = reader.get_int();
+                        event.wheel.preciseX = reader.get_float();
+                        event.wheel.preciseY = reader.get_float();
+                        break;
+                    case text_input:
+                        event.type = SDL_TEXTINPUT;
+                        reader.get_text(event.text.text, sizeof(event.text.text));
+                        break;
+                    case text_editing:
+                        event.type = SDL_TEXTEDITING;
+                        reader.get_text(event.edit.text, sizeof(event.edit.text));
+                        event.edit.start = reader.get_int();
+                        break;
+                    default:
+                        throw std::runtime_error("Input log has an unknown record");
+                }
+                events.push_back(event);
+            }
+        }
+
+        static InputLog load(const std::filesystem::path &file) {
+            std::ifstream stream(file, std::ios::binary | std::ios::ate);
+            if (!stream)
+                throw std::runtime_error("Cannot open input log: " + file.string());
+            std::vector<Uint8> data(static_cast<size_t>(stream.tellg()));
+            stream.seekg(0);
+            stream.read(reinterpret_cast<char *>(data.data()), static_cast<std::streamsize>(data.size()));
+            return InputLog(data);
+        }
+
+        [[nodiscard]] size_t frame_count() const noexcept {
+            return frame_ends.size();
+        }
+
+        /*Give the events of a frame to the manager, wrapped by record() and refresh()*/
+        template<typename MgrType>
+        void feed_frame(MgrType &mgr, size_t frame) const {
+            mgr.record();
+            for (size_t i = frame == 0 ? 0 : frame_ends[frame - 1]; i < frame_ends[frame]; i++)
+                feed(mgr, events[i]);
+            mgr.refresh();
+        }
+    };
+
+/*An SDL video subsystem on the dummy driver with a hidden window and a software renderer,
+ for driving widgets without a display*/
+    class HeadlessVideo final {
+    protected:
+        WindowPtr window = nullptr;
+        Renderer *renderer = nullptr;
+    public:
+        explicit HeadlessVideo(const Point &size = {800, 600}) {
+            SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+            if (SDL_InitSubSystem(SDL_INIT_VIDEO) != 0)
+                throw std::runtime_error(std::string("Cannot initialize the dummy video driver: ") + SDL_GetError());
+            window = SDL_CreateWindow("", 0, 0, size.x, size.y, SDL_WINDOW_HIDDEN);
+            if (window == nullptr) {
+                SDL_QuitSubSystem(SDL_INIT_VIDEO);
+                throw std::runtime_error(std::string("Cannot create a headless window: ") + SDL_GetError());
+            }
+            renderer = new Renderer(window, -1, SDL_RENDERER_SOFTWARE);
+        }
+
+        ~HeadlessVideo() {
+            delete renderer;
+            SDL_DestroyWindow(window);
+            SDL_QuitSubSystem(SDL_INIT_VIDEO);
+        }
+
+        HeadlessVideo(const HeadlessVideo &) = delete;
+
+        HeadlessVideo &operator=(const HeadlessVideo &) = delete;
+
+        [[nodiscard]] Renderer &get_renderer() noexcept {
+            return *renderer;
+        }
+    };
+
+/*Drives a widget tree from an input log frame by frame, timing process() and present()*/
+    class InputPlayer final {
+    public:
+        /*Percentiles of the frame times, in milliseconds*/
+        struct Timing {
+            double p50 = 0, p90 = 0, p99 = 0, max = 0;
+        };
+
+        struct Report {
+            size_t frames = 0;
+            Timing process, present;
+        };
+
+    protected:
+        const InputLog &log;
+
+        static Timing percentiles(std::vector<double> &samples) {
+            Timing result;
+            if (samples.empty())
+                return result;
+            std::sort(samples.begin(), samples.end());
+            auto at = [&](double percentile) {
+                auto rank = static_cast<size_t>(std::ceil(percentile * static_cast<double>(samples.size())));
+                return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+            };
+            result.p50 = at(0.5);
+            result.p90 = at(0.9);
+            result.p99 = at(0.99);
+            result.max = samples.back();
+            return result;
+        }
+
+    public:
+        explicit InputPlayer(const InputLog &log) : log(log) {}
+
+/**
+ * Replay every frame of the log : feed the manager, process the widget, then clear, present and show the renderer.
+ * \param mgr the manager the widget is processed with
+ * \param widget the root of the widget tree, a Page for example
+ * \param renderer the renderer, the one of a HeadlessVideo for headless benchmarks
+ * \param rel the position the widget is processed and presented at. Defaults to (0, 0)
+ * \return the timing of process() and present() over all the frames*/
+        template<typename MgrType>
+        Report play(MgrType &mgr, WidgetBase<MgrType> &widget, Renderer &renderer, const Point &rel = {0, 0}) {
+            std::vector<double> process_times, present_times;
+            process_times.reserve(log.frame_count());
+            present_times.reserve(log.frame_count());
+            auto to_ms = 1000.0 / static_cast<double>(SDL_GetPerformanceFrequency());
+            WidgetResult result;
+            for (size_t frame = 0; frame < log.frame_count(); frame++) {
+                log.feed_frame(mgr, frame);
+                auto begin = SDL_GetPerformanceCounter();
+                widget.process(rel, mgr, result);
+                auto processed = SDL_GetPerformanceCounter();
+                renderer.clear();
+                widget.present(renderer, rel);
+                renderer.present();
+                widget.clear_dirty();
+                auto presented = SDL_GetPerformanceCounter();
+                process_times.push_back(static_cast<double>(processed - begin) * to_ms);
+                present_times.push_back(static_cast<double>(presented - processed) * to_ms);
+            }
+            return {log.frame_count(), percentiles(process_times), percentiles(present_times)};
+        }
+    };
+NS_END
+
+#endif //SDLCLASS_EXTINPUTREPLAY_HPP
@@ -6,243 +6,414 @@
 #define SDLCLASS_EXTKEYMGR_HPP
 
 #define KEY_MGR_TYPEDEFS using KeyType = typename KeyMgr<KeyType_>::KeyType;\
-using KeyMap = typename KeyMgr<KeyType>::KeyMap;
+using KeySet = typename KeyMgr<KeyType>::KeySet;
 
 #define MOUSE_BUTTON_TYPE decltype(SDL_Event().button.button)
 #define MOUSE_CLICK_MGR_PARENT KeyClickMgr<MOUSE_BUTTON_TYPE>
-#define MOUSE_KEYS std::initializer_list<MOUSE_BUTTON_TYPE>{0,1,2,3,4}
-#define MOUSE_KEYS_EXCEPT_0 std::initializer_list<MOUSE_BUTTON_TYPE>{1,2,3,4}
+#define MOUSE_KEYS std::initializer_list<MOUSE_BUTTON_TYPE>{SDL_BUTTON_LEFT, SDL_BUTTON_MIDDLE, SDL_BUTTON_RIGHT,\
+SDL_BUTTON_X1, SDL_BUTTON_X2}
+
+#include <string_view>
+#include <bit>
+#include <array>
 
 #include "ExtBase.h"
 
 NS_BEGIN
-/*A simple manager for keys down/up from all ranges*/
+/*Kinds of input received by managers since the last record(), see KeyMgr::events()*/
+    enum InputEvent : Uint32 {
+        ev_none = 0,
+        ev_key = 1 << 0,
+        ev_mouse_button = 1 << 1,
+        ev_mouse_motion = 1 << 2,
+        ev_mouse_wheel = 1 << 3,
+        ev_text = 1 << 4,
+        ev_mouse = ev_mouse_button | ev_mouse_motion | ev_mouse_wheel,
+        // Never received, subscribing to it means being processed every frame
+        ev_frame = 1u << 31,
+        ev_all = ~0u
+    };
+
+/*A simple manager for keys down/up from all ranges.
+ * The states are kept in bitsets : keycodes below 512 and scancode keycodes (with SDLK_SCANCODE_MASK) are indexed directly,
+ other keys are given an index by a small hash map when registered*/
     template<typename KeyType_=SDL_Keycode>
     class KeyMgr {
     protected:
         using KeyType = KeyType_;
-        using KeyMap = std::unordered_map<KeyType, bool>;
-        KeyMap key_down;
+        using Word = Uint64;
+        using KeySet = std::vector<Word>;
+        static constexpr size_t word_bits = 64, direct_keys = 512, scancode_keys = 512,
+                dense_keys = direct_keys + scancode_keys, npos = ~size_t(0);
+        KeySet key_down, registered;
+        // The indexes of registered keys out of the dense range, and the keys of these indexes
+        std::unordered_map<KeyType, size_t> overflow;
+        std::vector<KeyType> overflow_keys;
+        // The kind of event raised by down() and up()
+        Uint32 event_kind = ev_key;
+        Uint32 received = ev_none;
+
+        static constexpr size_t dense_index(KeyType key) noexcept {
+            auto code = static_cast<Sint64>(key);
+            if (code >= 0 && code < static_cast<Sint64>(direct_keys))
+                return code;
+            auto scancode = code & ~static_cast<Sint64>(SDLK_SCANCODE_MASK);
+            if ((code & SDLK_SCANCODE_MASK) && scancode >= 0 && scancode < static_cast<Sint64>(scancode_keys))
+                return direct_keys + scancode;
+            return npos;
+        }
+
+        // The index of the key in the sets, npos if it has none
+        [[nodiscard]] size_t index_of(KeyType key) const noexcept {
+            auto index = dense_index(key);
+            if (index != npos || overflow.empty())
+                return index;
+            auto iter = overflow.find(key);
+            return iter == overflow.end() ? npos : iter->second;
+        }
+
+        [[nodiscard]] KeyType key_of(size_t index) const noexcept {
+            if (index < direct_keys)
+                return static_cast<KeyType>(index);
+            if (index < dense_keys)
+                return static_cast<KeyType>((index - direct_keys) | SDLK_SCANCODE_MASK);
+            return overflow_keys[index - dense_keys];
+        }
+
+        static bool test(const KeySet &set, size_t index) noexcept {
+            return index < set.size() * word_bits && (set[index / word_bits] >> (index % word_bits) & 1);
+        }
+
+        static void assign(KeySet &set, size_t index, bool value) noexcept {
+            auto &word = set[index / word_bits];
+            Word mask = Word(1) << (index % word_bits);
+            word = (word & ~mask) | (-Word(value) & mask);
+        }
+
+        // Make the set as large as key_down, new keys are not set
+        void fit(KeySet &set) const {
+            set.resize(key_down.size());
+        }
+
+        // Register the key, giving it an index if it is out of the dense range
+        size_t add_key(KeyType key) {
+            auto index = index_of(key);
+            if (index == npos) {
+                index = dense_keys + overflow_keys.size();
+                overflow.insert({key, index});
+                overflow_keys.push_back(key);
+                size_t words = index / word_bits + 1;
+                if (key_down.size() < words) {
+                    key_down.resize(words);
+                    registered.resize(words);
+                }
+            }
+            assign(registered, index, true);
+            return index;
+        }
+
     public:
-        explicit KeyMgr(const std::vector<KeyType> &init) {
+        explicit KeyMgr(const std::vector<KeyType> &init) :
+                key_down(dense_keys / word_bits), registered(dense_keys / word_bits) {
             for (const auto &key: init)
-                key_down.insert({key, false});
+                add_key(key);
+        }
+
+        /*The InputEvent flags received since the last clear_events()*/
+        [[nodiscard]] constexpr Uint32 events() const noexcept {
+            return received;
+        }
+
+        void clear_events() noexcept {
+            received = ev_none;
         }
 
         void init(const std::vector<KeyType> &init) {
             for (const auto &key: init)
-                key_down.insert({key, false});
+                add_key(key);
         }
 
-        void down_unchecked(const KeyType &key) noexcept {
-            key_down[key] = true;
+        // Unchecked functions register the key if it is not
+        void down_unchecked(const KeyType &key) {
+            assign(key_down, add_key(key), true);
+            received |= event_kind;
         }
 
         void down(const KeyType &key) noexcept {
-            try {
-                key_down.at(key) = true;
-            } catch (const std::out_of_range &) {}
+            received |= event_kind;
+            auto index = index_of(key);
+            if (test(registered, index))
+                assign(key_down, index, true);
         }
 
-        void up_unchecked(const KeyType &key) noexcept {
-            key_down[key] = false;
+        void up_unchecked(const KeyType &key) {
+            assign(key_down, add_key(key), false);
+            received |= event_kind;
         }
 
         void up(const KeyType &key) noexcept {
-            try {
-                key_down.at(key) = false;
-            } catch (const std::out_of_range &) {}
+            received |= event_kind;
+            auto index = index_of(key);
+            if (test(registered, index))
+                assign(key_down, index, false);
         }
 
-        constexpr bool is_down(const KeyType &key) const noexcept {
-            try {
-                return key_down.at(key);
-            } catch (const std::out_of_range &) {
-                return false;
-            }
+        bool is_down(const KeyType &key) const noexcept {
+            return test(key_down, index_of(key));
         }
 
-        constexpr bool is_down_unchecked(const KeyType &key) const noexcept {
-            return key_down[key];
+        bool is_down_unchecked(const KeyType &key) const noexcept {
+            return test(key_down, index_of(key));
         }
 
-        constexpr bool is_up(const KeyType &key) const noexcept {
-            try {
-                return !key_down.at(key);
-            } catch (const std::out_of_range &) {
-                return true;
-            }
+        bool is_up(const KeyType &key) const noexcept {
+            return !is_down(key);
         }
 
-        constexpr bool is_up_unchecked(const KeyType &key) const noexcept {
-            return !key_down[key];
+        bool is_up_unchecked(const KeyType &key) const noexcept {
+            return !is_down(key);
         }
     };
 
 /*Subclass of KeyMgr, but added records for key clicked
- * NOTICE : record() MUST be called before down() and up(); refresh() must be called after the key management*/
+ * NOTICE : record() MUST be called before down(), up() and text_input(); refresh() must be called after the key management*/
     template<typename KeyType_=SDL_Keycode>
     class KeyClickMgr : public KeyMgr<KeyType_> {
     protected:
         KEY_MGR_TYPEDEFS
-        KeyMap key_prev, key_click, key_release;
+        using Word = typename KeyMgr<KeyType>::Word;
+        KeySet key_prev, key_click, key_release;
     public:
-        KeyType cur_click;
+        /*A key clicked (down) or released in a frame*/
+        struct Transition {
+            KeyType key;
+            bool down;
+        };
+    protected:
+        std::vector<Transition> transitions;
+        // UTF-8 text committed since the last record(), the storage is reused between frames
+        std::string text_buffer;
+        // The text being composed by an input method, kept until the input method changes it
+        std::string composition;
+        int composition_cursor = 0;
+        // Whether the event loop gives SDL_TEXTINPUT or SDL_TEXTEDITING events to this manager at all
+        bool text_fed = false;
+    public:
+        KeyType cur_click = 0;
 
         explicit KeyClickMgr(const std::vector<KeyType> &init) : KeyMgr<KeyType>(init) {
-            for (const auto &key: init) {
-                key_prev.insert({key, false});
-                key_click.insert({key, false});
-                key_release.insert({key, false});
-            }
+            this->fit(key_prev);
+            this->fit(key_click);
+            this->fit(key_release);
         }
 
+        // The previous states are kept by refresh(), so nothing is copied here
         virtual void record() {
-            key_prev = this->key_down;
+            text_buffer.clear();
+            this->clear_events();
+        }
+
+        /*Append the text of an SDL_TEXTINPUT event, all the text received between two record() is kept*/
+        void text_input(const SDL_TextInputEvent &event) {
+            text_buffer.append(event.text);
+            text_fed = true;
+            this->received |= ev_text;
+        }
+
+        /*Update the composition from an SDL_TEXTEDITING event*/
+        void text_editing(const SDL_TextEditingEvent &event) {
+            composition.assign(event.text);
+            composition_cursor = event.start;
+            text_fed = true;
+            this->received |= ev_text;
+        }
+
+        /*Whether text_input() or text_editing() was ever called. If not, the text typed is only known by key clicks*/
+        [[nodiscard]] bool receives_text() const noexcept {
+            return text_fed;
+        }
+
+        /*The UTF-8 text committed since the last record()*/
+        [[nodiscard]] std::string_view text() const noexcept {
+            return text_buffer;
+        }
+
+        [[nodiscard]] const std::string &get_composition() const noexcept {
+            return composition;
         }
 
+        [[nodiscard]] int get_composition_cursor() const noexcept {
+            return composition_cursor;
+        }
+
+/*Compute the clicks and releases of all the keys in one pass over the words, listing them in get_transitions().
+ cur_click becomes the first key clicked, or 0.*/
         virtual void refresh() {
-            for (const auto &key: key_prev) {
-                auto &k_d = this->key_down.at(key.first);
-                if (k_d ^ key.second) {
-                    if (k_d)
-                        cur_click = key.first;
-                    key_click.at(key.first) = k_d;
-                    key_release.at(key.first) = !k_d;
-                    return;
-                } else {
-                    key_click.at(key.first) = false;
-                    key_release.at(key.first) = false;
+            this->fit(key_prev);
+            this->fit(key_click);
+            this->fit(key_release);
+            transitions.clear();
+            cur_click = 0;
+            bool clicked = false;
+            for (size_t i = 0; i < key_prev.size(); i++) {
+                Word down = this->key_down[i], changed = down ^ key_prev[i];
+                key_click[i] = changed & down;
+                key_release[i] = changed & key_prev[i];
+                key_prev[i] = down;
+                // Only the changed bits are visited
+                for (; changed != 0; changed &= changed - 1) {
+                    auto bit = std::countr_zero(changed);
+                    transitions.push_back({this->key_of(i * this->word_bits + bit), static_cast<bool>(down >> bit & 1)});
+                }
+                if (!clicked && key_click[i] != 0) {
+                    cur_click = this->key_of(i * this->word_bits + std::countr_zero(key_click[i]));
+                    clicked = true;
                 }
             }
-            cur_click = 0;
+        }
+
+        /*The keys clicked and released in this frame, ordered by their index*/
+        [[nodiscard]] const std::vector<Transition> &get_transitions() const noexcept {
+            return transitions;
         }
 
         virtual void refresh_unchecked() noexcept {
-            for (const auto &key: key_prev) {
-                auto &k_d = this->key_down[key.first];
-                if (k_d ^ key.second) {
-                    cur_click = key.first;
-                    key_click[key.first] = k_d;
-                    key_release[key.first] = !k_d;
-                    return;
-                }
-            }
+            refresh();
         }
 
-        bool is_click(KeyType key) const {
-            try {
-                return key_click.at(key);
-            } catch (const std::out_of_range &) {
-                return false;
-            }
+        bool is_click(KeyType key) const noexcept {
+            return this->test(key_click, this->index_of(key));
         }
 
         bool is_click_unchecked(KeyType key) const noexcept {
-            return key_click[key];
+            return this->test(key_click, this->index_of(key));
         }
 
-        bool is_release(KeyType key) const {
-            try {
-                return key_release.at(key);
-            } catch (const std::out_of_range &) {
-                return true;
-            }
+        // Keys not registered are always released
+        bool is_release(KeyType key) const noexcept {
+            auto index = this->index_of(key);
+            return !this->test(this->registered, index) || this->test(key_release, index);
         }
 
         bool is_release_unchecked(KeyType key) const noexcept {
-            return key_release[key];
+            return this->test(key_release, this->index_of(key));
         }
     };
 
+/*A manager for the mouse buttons, with the positions kept in a fixed array indexed by the button id :
+ * pos is the cursor, left to x2 are where the buttons were pressed in this frame, move is the motion of this frame*/
     class MouseMgr : public MOUSE_CLICK_MGR_PARENT {
-    protected:
     public:
         using MgrParent = MOUSE_CLICK_MGR_PARENT;
         using KeyType = MgrParent::KeyType;
-        using KeyMap = MgrParent::KeyMap;
+        using KeySet = MgrParent::KeySet;
         using ButtonType = MOUSE_BUTTON_TYPE;
-        std::unordered_map<ButtonType, Point> position;
+
+        static const int pos = 0, left = SDL_BUTTON_LEFT, middle = SDL_BUTTON_MIDDLE, right = SDL_BUTTON_RIGHT,
+                x1 = SDL_BUTTON_X1, x2 = SDL_BUTTON_X2, move = x2 + 1;
+
+        // position[move] is the motion of the frame, summed over all the motion events
+        std::array<Point, move + 1> position;
+        // The wheel motion of the frame in notches, and in fractions of notches for precise devices such as touchpads
         Point wheel_rel;
+        FPoint wheel_precise;
 
-        static const int pos = 0, left = 1, middle = 2, right = 3, move = 4;
+    protected:
+        static constexpr bool is_button(ButtonType button) noexcept {
+            return button >= left && button <= x2;
+        }
 
+    public:
         MouseMgr() : MgrParent(MOUSE_KEYS) {
-            for (auto key: MOUSE_KEYS)
-                position.insert({key, VOID_POINT});
+            event_kind = ev_mouse_button;
+            position.fill(VOID_POINT);
         }
 
         void record() override {
             MgrParent::record();
             wheel_rel.to0();
-            for (auto &key: MOUSE_KEYS_EXCEPT_0)
-                position.at(key).to0();
+            wheel_precise.to0();
+            for (int key = left; key <= move; key++)
+                position[key].to0();
         }
 
-        void motion(const SDL_MouseMotionEvent &button) {
-            auto &prev = position.at(pos);
-            position.at(move) = {button.x - prev.x, button.y - prev.y};
-            prev = {button.x, button.y};
+        /*The relative motion reported by SDL is summed, so no event of a frame is lost,
+         and it is still reported in relative mode, where the cursor does not move*/
+        void motion(const SDL_MouseMotionEvent &button) noexcept {
+            received |= ev_mouse_motion;
+            position[move] += Point{button.xrel, button.yrel};
+            position[pos] = {button.x, button.y};
         }
 
+        // The values are kept as SDL reports them, so the scroll direction follows the system setting
         void wheel_motion(const SDL_MouseWheelEvent &wheel_event) noexcept {
-            wheel_rel = {wheel_event.x, wheel_event.y};
+            received |= ev_mouse_wheel;
+            wheel_rel += Point{wheel_event.x, wheel_event.y};
+            wheel_precise += FPoint{wheel_event.preciseX, wheel_event.preciseY};
+        }
+
+/**
+ * Hide the cursor and report the motion without limit by the window border, for dragging and camera control.
+ * \return whether the mode is set, false if it is not supported*/
+        static bool set_relative_mode(bool enabled) noexcept {
+            return SDL_SetRelativeMouseMode(enabled ? SDL_TRUE : SDL_FALSE) == 0;
+        }
+
+        [[nodiscard]] static bool is_relative_mode() noexcept {
+            return SDL_GetRelativeMouseMode() == SDL_TRUE;
         }
 
         void down(const SDL_MouseButtonEvent &button) noexcept {
             MgrParent::down(button.button);
-            try {
-                position.at(button.button) = {button.x, button.y};
-            } catch (const std::out_of_range &) {}
+            if (is_button(button.button))
+                position[button.button] = {button.x, button.y};
         }
 
+        // All the buttons are registered, so this is the same as down()
         void down_unchecked(const SDL_MouseButtonEvent &button) noexcept {
-            MgrParent::down_unchecked(button.button);
-            position[button.button] = {button.x, button.y};
+            down(button);
         }
 
         void up(const SDL_MouseButtonEvent &button) noexcept {
             MgrParent::up(button.button);
-            try {
-                position.at(button.button) = VOID_POINT;
-            } catch (const std::out_of_range &) {}
+            if (is_button(button.button))
+                position[button.button] = VOID_POINT;
         }
 
         void up_unchecked(const SDL_MouseButtonEvent &button) noexcept {
-            MgrParent::up_unchecked(button.button);
-            position[button.button] = VOID_POINT;
+            up(button);
         }
 
 
         [[nodiscard]] bool unmoved() const noexcept {
-            return position.at(move).is0();
+            return position[move].is0();
         }
 
         [[nodiscard]] bool moved() const noexcept {
-            return position.at(move).isn0();
+            return position[move].isn0();
         }
 
         [[nodiscard]] bool wheel_unmoved() const noexcept {
-            return wheel_rel.is0();
+            return wheel_rel.is0() && wheel_precise.is0();
         }
 
         [[nodiscard]] bool wheel_moved() const noexcept {
-            return wheel_rel.isn0();
+            return !wheel_unmoved();
         }
 
         const Point &at(ButtonType button) const {
             return position.at(button);
         }
 
-        Point &at_unchecked(ButtonType button) {
+        Point &at_unchecked(ButtonType button) noexcept {
             return position[button];
         }
 
-        const Point &where() const {
-            return position.at(pos);
+        [[nodiscard]] const Point &where() const noexcept {
+            return position[pos];
         }
 
-        Point &operator[](ButtonType button) {
+        Point &operator[](ButtonType button) noexcept {
             return position[button];
         }
     };
@@ -260,6 +431,10 @@ NS_BEGIN
             mouse.record();
         }
 
+        [[nodiscard]] constexpr Uint32 events() const noexcept {
+            return this->received | mouse.events();
+        }
+
         void refresh() override {
             KeyClickMgr<KeyType_>::refresh();
             mouse.refresh();
@@ -271,6 +446,21 @@ NS_BEGIN
         }
     };
 
+    /*Get the mouse manager inside a manager, or nullptr if it has none*/
+    inline const MouseMgr *mouse_of(const MouseMgr &mgr) noexcept {
+        return &mgr;
+    }
+
+    template<typename KeyType>
+    const MouseMgr *mouse_of(const MouseAndKeyClickMgr<KeyType> &mgr) noexcept {
+        return &mgr.mouse;
+    }
+
+    template<typename MgrType>
+    const MouseMgr *mouse_of(const MgrType &) noexcept {
+        return nullptr;
+    }
+
 NS_END
 
 #undef KEY_MGR_TYPEDEFS
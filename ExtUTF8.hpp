@@ -0,0 +1,78 @@
+//
+// Created by Dogs-Cute on 10/17/2026.
+//
+
+#ifndef SDLCLASS_EXTUTF8_HPP
+#define SDLCLASS_EXTUTF8_HPP
+
+#include <string_view>
+
+#include "ExtBase.h"
+
+NS_BEGIN
+    namespace UTF8 {
+        constexpr Uint32 replacement = 0xFFFD;
+
+        constexpr bool is_continuation(char c) noexcept {
+            return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+        }
+
+        /*The byte length of the sequence starting with lead, or 1 for an invalid lead byte*/
+        constexpr size_t sequence_length(char lead) noexcept {
+            auto c = static_cast<unsigned char>(lead);
+            if (c < 0x80) return 1;
+            else if ((c & 0xE0) == 0xC0) return 2;
+            else if ((c & 0xF0) == 0xE0) return 3;
+            else if ((c & 0xF8) == 0xF0) return 4;
+            return 1;
+        }
+
+/**
+ * Decode the code point starting at \c index and move \c index to the next code point.
+ Invalid sequences decode as \c replacement and skip one byte*/
+        inline Uint32 decode(std::string_view text, size_t &index) noexcept {
+            auto c = static_cast<unsigned char>(text[index]);
+            size_t length = sequence_length(text[index]);
+            if (length == 1) {
+                index++;
+                return c < 0x80 ? c : replacement;
+            }
+            if (index + length > text.size()) {
+                index++;
+                return replacement;
+            }
+            Uint32 codepoint = c & (0x7F >> length);
+            for (size_t i = 1; i < length; i++) {
+                if (!is_continuation(text[index + i])) {
+                    index++;
+                    return replacement;
+                }
+                codepoint = (codepoint << 6) | (static_cast<unsigned char>(text[index + i]) & 0x3F);
+            }
+            index += length;
+            return codepoint;
+        }
+
+        /*The index of the code point after the one at index*/
+        inline size_t next(std::string_view text, size_t index) noexcept {
+            if (index >= text.size())
+                return text.size();
+            index++;
+            while (index < text.size() && is_continuation(text[index]))
+                index++;
+            return index;
+        }
+
+        /*The index of the code point before the one at index*/
+        inline size_t prev(std::string_view text, size_t index) noexcept {
+            if (index == 0)
+                return 0;
+            index--;
+            while (index > 0 && is_continuation(text[index]))
+                index--;
+            return index;
+        }
+    }
+NS_END
+
+#endif //SDLCLASS_EXTUTF8_HPP
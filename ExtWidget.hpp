@@ -49,10 +49,9 @@ NS_BEGIN
                         result.scrollbar.percentage = -1;
                     break;
                 case t_branch_page:
-                    if (same) {
+                    if (same)
                         result.branch_page->key = nullptr;
-                        delete result.branch_page->sub_res;
-                    } else
+                    else
                         delete result.branch_page;
                     break;
             }
@@ -75,34 +74,90 @@ NS_BEGIN
                 bool pressed, released;
             } button;
 
+            /*Results of the page elements, stored in slots indexed by element.
+             * Slots are kept after clear(), so processing a page again allocates nothing*/
             class PageResults {
             protected:
                 /*Notice : Use all the void * as Widget Pointers*/
                 using ConstWidgetPtr = const void *;
+                std::vector<ConstWidgetPtr> keys;
+                std::vector<WidgetResult *> results;
+                size_t count = 0;
+                // The slot of every key, rebuilt by the first lookup after a slot changes its key.
+                // Keys are kept by clear(), so a page giving its elements the same slots every frame never rebuilds it
+                mutable std::unordered_map<ConstWidgetPtr, size_t> lookup;
+                mutable bool lookup_valid = false;
             public:
-                std::unordered_map<ConstWidgetPtr, WidgetResult *> results;
-
                 PageResults() = default;
 
                 ~PageResults() {
-                    for (auto &pair: results)
-                        delete pair.second;
+                    for (auto result: results)
+                        delete result;
+                }
+
+                PageResults(const PageResults &) = delete;
+
+                PageResults &operator=(const PageResults &) = delete;
+
+                /*Get the result slot of the index for the widget, allocating it only the first time*/
+                WidgetResult &slot(size_t index, ConstWidgetPtr key) {
+                    while (results.size() <= index) {
+                        keys.push_back(nullptr);
+                        results.push_back(new WidgetResult());
+                    }
+                    if (keys[index] != key) {
+                        keys[index] = key;
+                        lookup_valid = false;
+                    }
+                    count = std::max(count, index + 1);
+                    return *results[index];
+                }
+
+                [[nodiscard]] WidgetResult &slot(size_t index) const {
+                    if (index >= count)
+                        throw std::out_of_range("PageResults slot " + std::to_string(index) + " is out of range");
+                    return *results[index];
                 }
 
-                void insert(const std::pair<ConstWidgetPtr, WidgetResult *> &pair) {
-                    results.insert(pair);
+                /*Mark all slots unused, keeping their memory and their keys*/
+                void clear() noexcept {
+                    count = 0;
                 }
 
-                void clear() {
-                    results.clear();
+                [[nodiscard]] size_t size() const noexcept {
+                    return count;
                 }
 
-                WidgetResult *&at(ConstWidgetPtr key) {
-                    return results.at(key);
+                /*Mark the first size slots used, keeping their keys and results as they were.
+                 * Return false and change nothing if some of them were never given by slot(index, key)*/
+                bool keep(size_t size) noexcept {
+                    if (results.size() < size)
+                        return false;
+                    count = std::max(count, size);
+                    return true;
                 }
 
-                WidgetResult *operator[](ConstWidgetPtr key) noexcept {
-                    return results[key];
+                /*Get the result of the widget by a hash lookup. slot(index), with the index returned by
+                 Page::insert(), is faster and does not build the lookup table*/
+                WidgetResult *at(ConstWidgetPtr key) const {
+                    auto result = (*this)[key];
+                    if (result == nullptr)
+                        throw std::out_of_range("PageResults has no result of the widget");
+                    return result;
+                }
+
+                WidgetResult *operator[](ConstWidgetPtr key) const {
+                    if (!lookup_valid) {
+                        lookup.clear();
+                        for (size_t i = 0; i < keys.size(); i++)
+                            if (keys[i] != nullptr)
+                                lookup.emplace(keys[i], i);
+                        lookup_valid = true;
+                    }
+                    auto iter = lookup.find(key);
+                    if (iter == lookup.end() || iter->second >= count)
+                        return nullptr;
+                    return results[iter->second];
                 }
             } *page;
 
@@ -116,9 +171,20 @@ NS_BEGIN
                 long double percentage;
             } scrollbar;
 
+            // The sub result is kept for the next processing once allocated
             struct BranchPageResult {
                 const void *key = nullptr;
                 WidgetResult *sub_res = nullptr;
+
+                BranchPageResult() = default;
+
+                ~BranchPageResult() {
+                    delete sub_res;
+                }
+
+                BranchPageResult(const BranchPageResult &) = delete;
+
+                BranchPageResult &operator=(const BranchPageResult &) = delete;
             } *branch_page;
 
             struct {
@@ -180,6 +246,10 @@ NS_BEGIN
         using PointRef = typename Point::PointRef;
         using ConstSchemeRef = const WidgetColorScheme &;
         Point pos;
+        // Whether the widget looks different since the last clear_dirty()
+        bool dirty = true;
+        // The InputEvent flags the widget reacts to
+        Uint32 interests = ev_all;
 
     public:
         explicit WidgetBase(const Point &pos) : pos(pos) {}
@@ -190,6 +260,44 @@ NS_BEGIN
             return pos;
         }
 
+/* The size of the area presented to, starting at view_pos().
+ * Widgets returning an empty size are considered to cover the whole page when dirty*/
+        [[nodiscard]] virtual Point view_size() const {
+            return {0, 0};
+        }
+
+        [[nodiscard]] Rect view_rect(PointRef rel) const {
+            return Rect::pos_size(pos + rel, view_size());
+        }
+
+        void mark_dirty() noexcept {
+            dirty = true;
+        }
+
+        virtual void clear_dirty() noexcept {
+            dirty = false;
+        }
+
+        [[nodiscard]] constexpr bool is_dirty() const noexcept {
+            return dirty;
+        }
+
+/* Set the InputEvent flags the widget reacts to. Pages in event driven mode process the widget only when one of them is received.
+ * Subscribe to ev_frame to be processed every frame*/
+        void subscribe(Uint32 events) noexcept {
+            interests = events;
+        }
+
+        [[nodiscard]] constexpr Uint32 get_interests() const noexcept {
+            return interests;
+        }
+
+/* Whether the widget must be processed even when the mouse is not on it, like a pressed button or a focused input box.
+ * Pages with a hit index process other widgets only when the mouse is on them*/
+        [[nodiscard]] virtual bool captured() const noexcept {
+            return false;
+        }
+
 /* Processing the widget, called BEFORE present().
  Parameters:
  * rel : The relative processing position
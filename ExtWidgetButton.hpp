@@ -6,6 +6,7 @@
 #define SDLCLASS_EXTWIDGETBUTTON_HPP
 
 #include "ExtWidget.hpp"
+#include "ExtWidgetChrome.hpp"
 
 #define BUTTON_PARENT WidgetBase<MouseMgr>
 #define ENABLE_IF_DRAGGABLE(ret_type) template <bool draggable_ = draggable> \
@@ -23,10 +24,11 @@ NS_BEGIN
         using PressedPred = bool (*)(const MgrType &, const Rect &, bool);
         Point size, img_rel;
         NumType outline_size;
-        Surface img;
+        // Not managed, the image must outlive the button
+        WidgetImage img;
         ConstSchemeRef scheme;
 
-        Surface *surface = nullptr;
+        Chrome chrome;
 
         PressedPred pressed_pred;
 
@@ -44,28 +46,6 @@ NS_BEGIN
                    (but_rect.contains(mgr.mouse.at(MouseMgr::left)) || is_front);
         }
 
-        void draw_front() {
-            delete surface;
-            surface = new Surface(size);
-            surface->fill_rect(scheme.front_outline);
-            surface->fill_rect(scheme.front_body,
-                               Rect{outline_size, outline_size,
-                                    size.x - outline_size * 2, size.y - outline_size * 2});
-            if (img.ptr())
-                surface->blit(img, img_rel);
-        }
-
-        void draw_back() {
-            delete surface;
-            surface = new Surface(size);
-            surface->fill_rect(scheme.back_outline);
-            surface->fill_rect(scheme.back_body,
-                               Rect{outline_size, outline_size,
-                                    size.x - outline_size * 2, size.y - outline_size * 2});
-            if (img.ptr())
-                surface->blit(img, img_rel);
-        }
-
     public:
         bool is_front = false;
 
@@ -91,50 +71,55 @@ NS_BEGIN
                ConstSchemeRef scheme = scheme_bright, PressedPred pressed_pred = mouse_pressed) :
                 WidgetParent{pos},
                 size(size), outline_size(outline_size),
-                img(img, false),
-                scheme(scheme),
+                img(img),
+                scheme(scheme), chrome(scheme),
                 pressed_pred(pressed_pred) {
+            if (pressed_pred == PressedPred(mouse_pressed))
+                this->subscribe(ev_mouse);
             if (img != nullptr) {
                 if (img_pos == nullptr) {
                     img_rel = {(size.x - img->w) / 2, (size.y - img->h) / 2};
                 } else this->img_rel = *img_pos;
             }
-            draw_back();
         }
 
         Button(PointRef pos, const ButtonStyle &style, SDLSurfacePtr img) :
                 WidgetParent{pos},
                 size(style.size), outline_size(style.outline_size),
-                img(img, false),
-                scheme(style.scheme),
+                img(img),
+                scheme(style.scheme), chrome(style.scheme),
                 pressed_pred(style.pressed_pred) {
+            if (pressed_pred == PressedPred(mouse_pressed))
+                this->subscribe(ev_mouse);
             if (img != nullptr) {
                 if (style.img_pos == nullptr) {
                     img_rel = {(size.x - img->w) / 2, (size.y - img->h) / 2};
                 } else this->img_rel = *style.img_pos;
             }
-            draw_back();
-        }
-
-        ~Button() override {
-            delete surface;
         }
 
-
         bool to_front() {
             if (is_front) return false;
-            draw_front();
             is_front = true;
+            this->mark_dirty();
             return true;
         }
 
         bool to_back() {
             if (!is_front) return false;
-            draw_back();
             is_front = false;
+            this->mark_dirty();
             return true;
         }
 
+        [[nodiscard]] Point view_size() const override {
+            return size;
+        }
+
+        [[nodiscard]] bool captured() const noexcept override {
+            return is_front;
+        }
+
         Rect get_rect(PointRef rel) const {
             Point real = this->pos + rel;
             return {real.x, real.y, size.x, size.y};
@@ -151,7 +136,8 @@ NS_BEGIN
         }
 
         WIDGET_PRESENT override {
-            surface->copy_to(renderer, this->pos + rel);
+            chrome.copy_to(renderer, get_rect(rel), outline_size, is_front ? Chrome::front : Chrome::back);
+            img.copy_to(renderer, this->pos + img_rel + rel);
         }
 
         WIDGET_TYPE(WidgetResult::t_button);
@@ -0,0 +1,170 @@
+//
+// Created by Dogs-Cute on 10/17/2026.
+//
+
+#ifndef SDLCLASS_EXTWIDGETCHROME_HPP
+#define SDLCLASS_EXTWIDGETCHROME_HPP
+
+#include "ExtBase.h"
+#include "ExtWidget.hpp"
+
+NS_BEGIN
+/*The outline and body of widgets, drawn by the GPU at any size.
+ The colors of a scheme are kept in a palette of 4 texels shared by all the widgets using the scheme,
+ the outline and the body are stretched from their texel, so no surface depends on the widget size.*/
+    class Chrome final {
+    public:
+        enum State : Uint8 {
+            back,
+            front
+        };
+
+    protected:
+        using NumType = typeof(Point::x);
+        using ConstSchemeRef = const WidgetColorScheme &;
+        using PalettePtr = std::shared_ptr<const Surface>;
+        // The colors of a scheme, compared by value
+        using Key = std::tuple<Uint32, Uint32, Uint32, Uint32>;
+
+        struct Cache {
+            std::mutex mutex;
+            std::map<Key, std::weak_ptr<const Surface>> palettes;
+        };
+
+        // Texels of the palette, the outline and body of a state are next to each other
+        enum Texel : int {
+            back_outline,
+            back_body,
+            front_outline,
+            front_body,
+            texel_count
+        };
+
+        PalettePtr palette;
+
+        static Cache &cache() {
+            static Cache instance;
+            return instance;
+        }
+
+        static Uint32 pack_color(const Color &color) noexcept {
+            return Uint32(color.r) << 24 | Uint32(color.g) << 16 | Uint32(color.b) << 8 | color.a;
+        }
+
+        // Get the palette of a scheme, rendering it only if no widget of the scheme is alive
+        static PalettePtr get_palette(ConstSchemeRef scheme) {
+            Key key{pack_color(scheme.back_outline), pack_color(scheme.back_body),
+                    pack_color(scheme.front_outline), pack_color(scheme.front_body)};
+            auto &instance = cache();
+            std::lock_guard lock(instance.mutex);
+            auto iter = instance.palettes.find(key);
+            if (iter != instance.palettes.end())
+                if (auto shared = iter->second.lock())
+                    return shared;
+            std::erase_if(instance.palettes, [](const auto &pair) { return pair.second.expired(); });
+            auto result = std::make_shared<Surface>(texel_count, 1);
+            result->fill_rect(scheme.back_outline, Rect{back_outline, 0, 1, 1});
+            result->fill_rect(scheme.back_body, Rect{back_body, 0, 1, 1});
+            result->fill_rect(scheme.front_outline, Rect{front_outline, 0, 1, 1});
+            result->fill_rect(scheme.front_body, Rect{front_body, 0, 1, 1});
+            instance.palettes[key] = result;
+            return result;
+        }
+
+    public:
+        explicit Chrome(ConstSchemeRef scheme) : palette(get_palette(scheme)) {}
+
+/**
+ * Draw the outline and the body in \c dst. Widgets of the same scheme draw from the same texture,
+ so the chrome of widgets not overlapping is drawn together in deferred mode.
+ * \param renderer the renderer to draw on
+ * \param dst where the widget is
+ * \param outline_size the length of the outline
+ * \param state which colors of the scheme are used*/
+        void copy_to(Renderer &renderer, const Rect &dst, NumType outline_size, State state) const {
+            auto texture = renderer.cached_texture(palette->ptr(), palette->get_stamp());
+            if (texture == nullptr)
+                return;
+            // Stretching a single texel must not blend it with its neighbours
+            SDL_SetTextureScaleMode(texture, SDL_ScaleModeNearest);
+            int outline = state == front ? front_outline : back_outline;
+            Rect outline_texel{outline, 0, 1, 1}, body_texel{outline + 1, 0, 1, 1};
+            renderer.copy(texture, outline_texel, dst);
+            if (outline_size * 2 < dst.w && outline_size * 2 < dst.h) {
+                Rect body{dst.x + outline_size, dst.y + outline_size,
+                          dst.w - outline_size * 2, dst.h - outline_size * 2};
+                renderer.copy(texture, body_texel, body);
+            }
+        }
+
+        // The number of distinct palettes alive
+        static size_t size() {
+            auto &instance = cache();
+            std::lock_guard lock(instance.mutex);
+            std::erase_if(instance.palettes, [](const auto &pair) { return pair.second.expired(); });
+            return instance.palettes.size();
+        }
+    };
+
+/*An image given to widgets, such as a button icon, which is not owned by them.
+ * The widgets showing a surface share a stamp for the texture cache of renderers. The stamp is dropped when the last
+ of them is destroyed, so a new surface allocated at the same address is uploaded again instead of showing the old texture.
+ * \attention The surface must outlive the widgets, and must not be modified once given to them*/
+    class WidgetImage final {
+    protected:
+        struct Registry {
+            std::mutex mutex;
+            // The stamp of every surface shown by widgets, and the number of widgets showing it
+            std::unordered_map<ConstSDLSurfacePtr, std::pair<Uint64, size_t>> images;
+        };
+
+        SDLSurfacePtr surface;
+        Uint64 stamp = 0;
+
+        static Registry &registry() {
+            static Registry instance;
+            return instance;
+        }
+
+    public:
+        explicit WidgetImage(SDLSurfacePtr surface) : surface(surface) {
+            if (surface == nullptr)
+                return;
+            auto &instance = registry();
+            std::lock_guard lock(instance.mutex);
+            auto &image = instance.images[surface];
+            if (image.second++ == 0)
+                image.first = SurfaceBase::next_stamp();
+            stamp = image.first;
+        }
+
+        ~WidgetImage() {
+            if (surface == nullptr)
+                return;
+            auto &instance = registry();
+            std::lock_guard lock(instance.mutex);
+            auto iter = instance.images.find(surface);
+            if (iter != instance.images.end() && --iter->second.second == 0)
+                instance.images.erase(iter);
+        }
+
+        WidgetImage(const WidgetImage &) = delete;
+
+        WidgetImage &operator=(const WidgetImage &) = delete;
+
+        [[nodiscard]] constexpr SDLSurfacePtr ptr() const noexcept {
+            return surface;
+        }
+
+        [[nodiscard]] constexpr Uint64 get_stamp() const noexcept {
+            return stamp;
+        }
+
+        void copy_to(Renderer &renderer, const Point &dst) const {
+            if (surface != nullptr)
+                renderer.copy(renderer.cached_texture(surface, stamp), nullptr, Rect{surface, dst});
+        }
+    };
+NS_END
+
+#endif //SDLCLASS_EXTWIDGETCHROME_HPP
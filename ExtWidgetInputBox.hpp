@@ -10,56 +10,169 @@
 #include "ExtBase.h"
 #include "ExtColor.hpp"
 #include "ExtWidget.hpp"
+#include "ExtWidgetChrome.hpp"
+#include "ExtUTF8.hpp"
+#include "ExtGapBuffer.hpp"
 
 NS_BEGIN
+/*A box of text typed by the user, wrapped in lines.
+ * For text of any language and input methods, the event loop must give SDL_TEXTINPUT and SDL_TEXTEDITING
+ to the manager by text_input() and text_editing(), or by feed(). Otherwise only printable ASCII keys are typed.*/
     WIDGET_TEMPLATE(=MouseAndKeyClickMgr<>)
 
     class InputBox final : public WidgetBase<MgrType> {
     protected:
         WIDGET_TYPEDEFS
         using OnClickPred = bool (*)(const MgrType &, const Rect &, bool);
-        using CharInput = bool (*)(const MgrType &, std::string &);
+        using CharInput = bool (*)(const MgrType &, GapBuffer &);
 
+        GapBuffer buffer;
+        // A copy of the buffer, updated once per frame when the buffer has changed
         std::string input;
         Point size, background_rel, text_rel;
         Font &font;
         const Color &font_color;
         NumType outline_size;
-        SDLSurfacePtr background;
+        WidgetImage background;
         ConstSchemeRef scheme;
 
-        Surface *back = nullptr, *text = nullptr;
+        Chrome chrome;
         bool is_front = false;
 
+        // A wrapped line of the input, [begin, end) in bytes, rendered on its own
+        struct Line {
+            size_t begin, end;
+            std::unique_ptr<Surface> surface;
+        };
+        std::vector<Line> lines;
+        // The input the lines are laid out from
+        std::string rendered;
+        Uint64 rendered_version = 0;
+        // The position of the cursor relative to text_rel, and its byte index when computed
+        Point caret;
+        size_t caret_index = std::string::npos;
+        // The text being composed by an input method, shown at the caret
+        std::string composition;
+        std::unique_ptr<Surface> composition_surface;
+        NumType composition_caret = 0;
+
         OnClickPred on_click_pred;
         CharInput char_input;
 
-        void draw_front() {
-            delete back;
-            back = new Surface(size);
-            back->fill_rect(scheme.front_outline);
-            back->fill_rect(scheme.front_body,
-                            Rect{outline_size, outline_size,
-                                 size.x - outline_size * 2, size.y - outline_size * 2});
+        [[nodiscard]] int wrap_length() const noexcept {
+            return size.x - outline_size * 2;
+        }
+
+/* Break the line starting at begin, at a line break, or at the last space before the text exceeds wrap_length().
+ * Returns the end of the line and the beginning of the next one*/
+        [[nodiscard]] std::pair<size_t, size_t> break_line(size_t begin) const {
+            size_t limit = input.find('\n', begin);
+            if (limit == std::string::npos)
+                limit = input.size();
+            // A character is at least a pixel wide and 4 bytes long, so no more can fit in a line
+            size_t measured = std::min(limit, begin + static_cast<size_t>(std::max(wrap_length(), 1)) * 4);
+            int count = font.measure(input.substr(begin, measured - begin), wrap_length());
+            size_t fit = begin;
+            for (int i = 0; i < count && fit < measured; i++)
+                fit = UTF8::next(input, fit);
+            if (fit == limit)
+                return {limit, limit == input.size() ? limit : limit + 1};
+            if (input[fit] == ' ')
+                return {fit, fit + 1};
+            auto space = input.rfind(' ', fit);
+            if (space != std::string::npos && space > begin)
+                return {space, space + 1};
+            // A word longer than the line is broken anywhere, keeping at least one character
+            if (fit == begin)
+                fit = UTF8::next(input, begin);
+            return {fit, fit};
         }
 
-        void draw_back() {
-            delete back;
-            back = new Surface(size);
-            back->fill_rect(scheme.back_outline);
-            back->fill_rect(scheme.back_body,
-                            Rect{outline_size, outline_size,
-                                 size.x - outline_size * 2, size.y - outline_size * 2});
+        [[nodiscard]] Line render_line(size_t begin, size_t end) const {
+            Line line{begin, end, nullptr};
+            if (end > begin)
+                line.surface = std::make_unique<Surface>(font.render(input.substr(begin, end - begin), font_color));
+            return line;
+        }
+
+/* Lay out the input again if it has changed. Lines before the edit are kept, and lines after it are reused
+ once a new line starts where an old one did, so only the edited lines are rendered again*/
+        void update_text() {
+            if (buffer.get_version() == rendered_version && !lines.empty())
+                return;
+            buffer.copy_to(input);
+            rendered_version = buffer.get_version();
+            caret_index = std::string::npos;
+            size_t prefix = std::mismatch(input.begin(), input.begin() + std::min(input.size(), rendered.size()),
+                                          rendered.begin()).first - input.begin();
+            size_t suffix = 0, max_suffix = std::min(input.size(), rendered.size()) - prefix;
+            while (suffix < max_suffix && input[input.size() - suffix - 1] == rendered[rendered.size() - suffix - 1])
+                suffix++;
+            auto delta = static_cast<std::ptrdiff_t>(input.size()) - static_cast<std::ptrdiff_t>(rendered.size());
+            size_t edit_end = input.size() - suffix;
+
+            // The line before the edited one is laid out again too, as the edited word may move back to it
+            size_t first = 0;
+            while (first + 1 < lines.size() && lines[first + 1].begin <= prefix)
+                first++;
+            if (first > 0)
+                first--;
+            std::vector<Line> result;
+            result.reserve(lines.size() + 1);
+            for (size_t i = 0; i < first && i < lines.size(); i++)
+                result.push_back(std::move(lines[i]));
+
+            size_t begin = first < lines.size() ? lines[first].begin : 0, old_index = first;
+            while (true) {
+                if (begin >= edit_end) {
+                    while (old_index < lines.size() && static_cast<std::ptrdiff_t>(lines[old_index].begin) + delta <
+                                                       static_cast<std::ptrdiff_t>(begin))
+                        old_index++;
+                    if (old_index < lines.size() &&
+                        static_cast<std::ptrdiff_t>(lines[old_index].begin) + delta == static_cast<std::ptrdiff_t>(begin)) {
+                        for (; old_index < lines.size(); old_index++) {
+                            auto &line = lines[old_index];
+                            line.begin += delta;
+                            line.end += delta;
+                            result.push_back(std::move(line));
+                        }
+                        break;
+                    }
+                }
+                auto [end, next] = break_line(begin);
+                result.push_back(render_line(begin, end));
+                if (end == input.size())
+                    break;
+                begin = next;
+            }
+            lines = std::move(result);
+            rendered = input;
+            this->mark_dirty();
         }
 
-        void draw_background() {
-            if (background != nullptr)
-                back->blit(background, background_rel);
+        void update_caret() {
+            if (caret_index == buffer.cursor())
+                return;
+            caret_index = buffer.cursor();
+            size_t line = 0;
+            while (line + 1 < lines.size() && lines[line + 1].begin <= caret_index)
+                line++;
+            size_t begin = lines.empty() ? 0 : lines[line].begin;
+            caret = {begin < caret_index ? font.size(input.substr(begin, caret_index - begin)).x : 0,
+                     static_cast<NumType>(line) * font.line_skip()};
+            this->mark_dirty();
         }
 
-        void rerender_text() {
-            delete text;
-            text = new Surface(font.render_wrapped(input, font_color, size.x - outline_size * 2));
+        void update_composition(const std::string &cur, int cursor) {
+            if (cur == composition)
+                return;
+            composition = cur;
+            composition_surface.reset(composition.empty() ? nullptr : new Surface(font.render(composition, font_color)));
+            size_t end = 0;
+            for (int i = 0; i < cursor && end < composition.size(); i++)
+                end = UTF8::next(composition, end);
+            composition_caret = end > 0 ? font.size(composition.substr(0, end)).x : 0;
+            this->mark_dirty();
         }
 
         static typename std::enable_if<std::is_same<MgrType, MouseAndKeyClickMgr<>>::value, bool>::type
@@ -74,22 +187,47 @@ NS_BEGIN
         }
 
         static typename std::enable_if<std::is_same<MgrType, MouseAndKeyClickMgr<>>::value, bool>::type
-        keyboard_char_input(const MouseAndKeyClickMgr<> &mgr, std::string &input) {
-            switch (mgr.cur_click) {
-                case 0:
-                    break;
-                case '\b':
-                    if (!input.empty())
-                        input.pop_back();
-                    break;
-                case '\n':
-                    return true;
-                default:
-                    if (SDL_isprint(mgr.cur_click))
-                        input.push_back((char) mgr.cur_click);
-                    break;
+        keyboard_char_input(const MouseAndKeyClickMgr<> &mgr, GapBuffer &input) {
+            // Printable keys also come as SDL_TEXTINPUT while text input is active, so they are not inserted twice.
+            // An event loop not forwarding SDL_TEXTINPUT still types by key clicks
+            bool text_active = mgr.receives_text() && SDL_IsTextInputActive();
+            if (text_active)
+                input.insert(mgr.text());
+            // Every key clicked in the frame is handled, not only cur_click
+            bool end = false;
+            for (const auto &transition: mgr.get_transitions()) {
+                if (!transition.down)
+                    continue;
+                switch (transition.key) {
+                    case SDLK_BACKSPACE:
+                        input.erase_before();
+                        break;
+                    case SDLK_DELETE:
+                        input.erase_after();
+                        break;
+                    case SDLK_LEFT:
+                        input.left();
+                        break;
+                    case SDLK_RIGHT:
+                        input.right();
+                        break;
+                    case SDLK_HOME:
+                        input.home();
+                        break;
+                    case SDLK_END:
+                        input.end();
+                        break;
+                    case SDLK_RETURN:
+                    case '\n':
+                        end = true;
+                        break;
+                    default:
+                        if (!text_active && SDL_isprint(transition.key))
+                            input.insert((char) transition.key);
+                        break;
+                }
             }
-            return false;
+            return end;
         }
 
     public:
@@ -105,7 +243,7 @@ NS_BEGIN
  * \param background_pos the pointer of position of the background(if usable). If NULL, then the background will be shown at the center. Defaults to \c nullptr
  * \param scheme the scheme that the InputBox uses. Defaults to scheme_bright
  * \param on_click_pred this is a function that returns true when a press change is detected. Defaults to \c mouse_on_click
- * \param char_input this is a function that pushes or pops the input char according to key activities. Defaults to \c keyboard_char_input */
+ * \param char_input this is a function that edits the input and moves its cursor according to key activities. Defaults to \c keyboard_char_input */
         InputBox(PointRef pos, PointRef size, Font &font, const Color &font_color, NumType outline_size = 1,
                  std::string default_input = {}, const Point *input_pos = nullptr,
                  SDLSurfacePtr background = nullptr, const Point *background_pos = nullptr,
@@ -113,8 +251,10 @@ NS_BEGIN
                  OnClickPred on_click_pred = mouse_on_click, CharInput char_input = keyboard_char_input) :
                 WidgetParent{pos}, size(size), font(font), font_color(font_color),
                 outline_size(outline_size), input(std::move(default_input)),
-                background(background), scheme(scheme),
+                background(background), scheme(scheme), chrome(scheme),
                 on_click_pred(on_click_pred), char_input(char_input) {
+            if (on_click_pred == OnClickPred(mouse_on_click) && char_input == CharInput(keyboard_char_input))
+                this->subscribe(ev_mouse_button | ev_key | ev_text);
             if (background != nullptr) {
                 if (background_pos == nullptr)
                     background_rel = {(size.x - background->w) / 2, (size.y - background->h) / 2};
@@ -123,26 +263,30 @@ NS_BEGIN
             if (input_pos == nullptr)
                 text_rel = {outline_size * 2, (size.y - font.height()) / 2};
             else text_rel = *input_pos;
-            draw_back();
-        }
-
-        ~InputBox() override {
-            delete back;
-            delete text;
+            buffer.insert(input);
+            update_text();
         }
 
         bool to_front() {
-            draw_front();
             is_front = true;
+            this->mark_dirty();
             return true;
         }
 
         bool to_back() {
-            draw_back();
             is_front = false;
+            this->mark_dirty();
             return true;
         }
 
+        [[nodiscard]] Point view_size() const override {
+            return size;
+        }
+
+        [[nodiscard]] bool captured() const noexcept override {
+            return is_front;
+        }
+
         WIDGET_DELETES(InputBox)
 
         WIDGET_PROCESS override {
@@ -153,20 +297,41 @@ NS_BEGIN
                 else to_front();
             }
             if (is_front) {
-                result.result.input_box.end = char_input(mgr, input);
-                if (mgr.cur_click != 0)
-                    rerender_text();
+                result.result.input_box.end = char_input(mgr, buffer);
+                update_text();
+                update_caret();
+                update_composition(mgr.get_composition(), mgr.get_composition_cursor());
             }
-            if (input.empty())
-                draw_background();
             result.result.input_box.str = &input;
         }
 
         WIDGET_PRESENT override {
             Point real = this->pos + rel;
-            back->copy_to(renderer, this->pos + rel);
-            if (text != nullptr && text->ptr())
-                text->copy_to(renderer, this->pos + text_rel + rel);
+            chrome.copy_to(renderer, {real.x, real.y, size.x, size.y}, outline_size,
+                           is_front ? Chrome::front : Chrome::back);
+            // The background is shown only when no input is present
+            if (input.empty())
+                background.copy_to(renderer, this->pos + background_rel + rel);
+            Point line_pos = this->pos + text_rel + rel;
+            for (const auto &line: lines) {
+                if (line.surface != nullptr && line.surface->ptr())
+                    line.surface->copy_to(renderer, line_pos);
+                line_pos.y += font.line_skip();
+            }
+            if (is_front) {
+                Point caret_pos = this->pos + text_rel + rel + caret;
+                auto prev_color = renderer.get_color();
+                renderer.set_color(font_color);
+                if (composition_surface != nullptr && composition_surface->ptr()) {
+                    composition_surface->copy_to(renderer, caret_pos);
+                    // The composition is underlined, with the caret inside it
+                    renderer.fill_rect(Rect{caret_pos.x, caret_pos.y + font.height() - 1,
+                                            composition_surface->w(), 1});
+                    caret_pos.x += composition_caret;
+                }
+                renderer.fill_rect(Rect{caret_pos.x, caret_pos.y, 1, font.height()});
+                renderer.set_color(prev_color);
+            }
         }
 
         WIDGET_TYPE(WidgetResult::t_input_box)
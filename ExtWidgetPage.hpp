@@ -11,28 +11,320 @@
 NS_BEGIN
 /*A Page of contents that can manage every component repeatedly*/
     WIDGET_TEMPLATE()
-    class Page final : WidgetBase<MgrType> {
+    class Page final : public WidgetBase<MgrType> {
     protected:
         WIDGET_TYPEDEFS
         using ElementType = WidgetBase<MgrType>;
-        std::unordered_map<ElementType *, WidgetResult::WidgetType> elements;
+
+        struct Element {
+            ElementType *widget;
+            WidgetResult::WidgetType type;
+            int z;
+        };
+
+        // Elements in stable slots, removed slots have a null widget and are reused by insert()
+        std::vector<Element> elements;
+        // Slot indices in processing and drawing order : ascending z, then insertion order
+        std::vector<size_t> order;
+        std::vector<size_t> free_slots;
         bool independent;
+        // Regions changed since the last present, relative to this->pos
+        std::vector<Rect> dirty_rects;
+        std::unique_ptr<Texture> cache;
+        Rect cache_bounds;
+        bool cache_valid = false;
+        // A uniform grid of element slots over bounds(), see set_hit_index()
+        bool hit_index = false, hit_valid = false;
+        int hit_cell = 64, hit_cols = 0, hit_rows = 0;
+        Rect hit_area;
+        std::vector<std::vector<size_t>> hit_cells;
+        // Elements without a view size are routed every frame
+        std::vector<size_t> hit_always;
+        // The slots to process this frame and the last one, and the slots hit or captured that are processed again next frame
+        std::vector<size_t> routed, prev_routed, hit_keep;
+        // The results the routed elements were processed into, the others are reset in them already
+        const void *routed_results = nullptr;
+        std::vector<size_t> order_rank;
+        // 0 : not routed, 1 : routed, 2 : routed and under the mouse
+        std::vector<Uint8> routed_mark;
+        bool event_driven = false;
+
+        // The events an element must react to for being processed this frame
+        [[nodiscard]] Uint32 frame_events(const MgrType &mgr) const noexcept {
+            return event_driven ? mgr.events() | ev_frame : ev_all;
+        }
+
+        void build_hit_index() {
+            hit_area = bounds();
+            hit_cols = std::max((hit_area.w + hit_cell - 1) / hit_cell, 1);
+            hit_rows = std::max((hit_area.h + hit_cell - 1) / hit_cell, 1);
+            hit_cells.assign(static_cast<size_t>(hit_cols * hit_rows), {});
+            hit_always.clear();
+            order_rank.assign(elements.size(), 0);
+            for (size_t rank = 0; rank < order.size(); rank++) {
+                size_t slot = order[rank];
+                order_rank[slot] = rank;
+                auto rect = elements[slot].widget->view_rect({0, 0});
+                if (rect.empty()) {
+                    hit_always.push_back(slot);
+                    continue;
+                }
+                int col_begin = std::max((rect.x - hit_area.x) / hit_cell, 0),
+                        col_end = std::min((rect.x + rect.w - 1 - hit_area.x) / hit_cell, hit_cols - 1),
+                        row_begin = std::max((rect.y - hit_area.y) / hit_cell, 0),
+                        row_end = std::min((rect.y + rect.h - 1 - hit_area.y) / hit_cell, hit_rows - 1);
+                for (int row = row_begin; row <= row_end; row++)
+                    for (int col = col_begin; col <= col_end; col++)
+                        hit_cells[row * hit_cols + col].push_back(slot);
+            }
+            routed_mark.assign(elements.size(), 0);
+            hit_valid = true;
+        }
+
+        // Collect the slots under the pointer(relative to this->pos) together with the kept ones, in drawing order
+        void route(const Point &pointer) {
+            routed.clear();
+            auto add = [this](size_t slot, Uint8 mark) {
+                if (elements[slot].widget == nullptr)
+                    return;
+                if (routed_mark[slot] == 0)
+                    routed.push_back(slot);
+                routed_mark[slot] = std::max(routed_mark[slot], mark);
+            };
+            for (auto slot: hit_keep)
+                add(slot, 1);
+            for (auto slot: hit_always)
+                add(slot, 1);
+            if (hit_area.contains(pointer)) {
+                auto &cell = hit_cells[(pointer.y - hit_area.y) / hit_cell * hit_cols +
+                                       (pointer.x - hit_area.x) / hit_cell];
+                for (auto slot: cell)
+                    if (elements[slot].widget->view_rect({0, 0}).contains(pointer))
+                        add(slot, 2);
+            }
+            std::sort(routed.begin(), routed.end(), [this](size_t a, size_t b) {
+                return order_rank[a] < order_rank[b];
+            });
+        }
+
+        // Process only the routed elements. The results of the others are reset once, when they stop being routed
+        void process_routed(const Point &ele_rel, const MouseMgr &mouse, const MgrType &mgr,
+                            WidgetResult::WidgetUnion::PageResults &page_results) {
+            bool reset_all = !hit_valid || routed_results != &page_results || !page_results.keep(elements.size());
+            if (!hit_valid)
+                build_hit_index();
+            routed_results = &page_results;
+            routed.swap(prev_routed);
+            route(mouse.where() - ele_rel);
+            for (auto index: reset_all ? order : prev_routed)
+                if (routed_mark[index] == 0 && elements[index].widget != nullptr)
+                    page_results.slot(index, elements[index].widget).set_type(elements[index].type);
+            hit_keep.clear();
+            auto events = frame_events(mgr);
+            for (auto index: routed) {
+                auto widget = elements[index].widget;
+                auto &widget_result = page_results.slot(index, widget);
+                if (widget->get_interests() & events)
+                    widget->process(ele_rel, mgr, widget_result);
+                else
+                    widget_result.set_type(elements[index].type);
+                if (widget->is_dirty())
+                    add_dirty_rect(*widget);
+                if (routed_mark[index] == 2 || widget->captured())
+                    hit_keep.push_back(index);
+                routed_mark[index] = 0;
+            }
+        }
+
+        void add_dirty_rect(const ElementType &ele) {
+            auto rect = ele.view_rect({0, 0});
+            if (rect.empty())
+                rect = bounds();
+            dirty_rects.push_back(rect);
+            this->mark_dirty();
+        }
+
+        [[nodiscard]] size_t slot_of(const ElementType *ele) const {
+            for (size_t index = 0; index < elements.size(); index++)
+                if (elements[index].widget == ele)
+                    return index;
+            throw std::out_of_range("Element is not on this page");
+        }
+
+        void insert_order(size_t slot) {
+            int z = elements[slot].z;
+            auto iter = std::upper_bound(order.begin(), order.end(), z, [this](int value, size_t index) {
+                return value < elements[index].z;
+            });
+            order.insert(iter, slot);
+        }
+
+        void clear_dirty_elements() noexcept {
+            for (auto index: order)
+                elements[index].widget->clear_dirty();
+            dirty_rects.clear();
+            WidgetParent::clear_dirty();
+        }
+
+        // Create the page texture if the bounds changed, return false if the renderer cannot render to textures
+        bool prepare_cache(Renderer &renderer, const Rect &new_bounds) {
+            if (cache && cache_bounds.w == new_bounds.w && cache_bounds.h == new_bounds.h) {
+                // The texture is kept, but its pixels were drawn at the old origin
+                if (cache_bounds.x != new_bounds.x || cache_bounds.y != new_bounds.y)
+                    cache_valid = false;
+                cache_bounds = new_bounds;
+                return true;
+            }
+            cache_valid = false;
+            cache_bounds = new_bounds;
+            cache = std::make_unique<Texture>(SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                                                                SDL_TEXTUREACCESS_TARGET,
+                                                                std::max(new_bounds.w, 1), std::max(new_bounds.h, 1)));
+            if (cache->ptr() == nullptr) {
+                cache.reset();
+                return false;
+            }
+            cache->set_blend(SDL_BLENDMODE_BLEND);
+            return true;
+        }
+
+        // Clear the region of the page texture and present the elements intersecting it
+        void redraw_cache(Renderer &renderer, const Rect &region) {
+            Rect local = region - cache_bounds.lu();
+            renderer.set_clip(local);
+            renderer.fill_rect(local);
+            for (auto index: order) {
+                auto widget = elements[index].widget;
+                auto ele_rect = widget->view_rect({0, 0});
+                if (ele_rect.empty() || SDL_HasIntersection(ele_rect, region))
+                    widget->present(renderer, -cache_bounds.lu());
+            }
+        }
+
     public:
         /**
-         * \param elements a vector of Widgets with the same manager to be put on this page
+         * \param elements a vector of Widgets with the same manager to be put on this page, drawn in the order of the vector
          * \param independent whether the page will delete the elements when deconstructing*/
         explicit Page(PointRef pos, const std::vector<ElementType *> elements, bool independent = false)
                 : WidgetParent{pos},
                   independent(independent) {
-            for (auto &ele: elements) {
-                this->elements.insert({ele, ele->get_type()});
-            }
+            // The page reacts to everything its elements react to, which insert() adds up
+            this->subscribe(ev_none);
+            this->elements.reserve(elements.size());
+            order.reserve(elements.size());
+            for (auto &ele: elements)
+                insert(ele);
         }
 
         ~Page() override {
             if (independent)
                 for (auto &ele: elements)
-                    delete ele.first;
+                    delete ele.widget;
+        }
+
+/**
+ * Put the element on this page.
+ * \param ele the element, owned by the page if the page is independent
+ * \param z the layer of the element, elements with greater z are processed and drawn later. Defaults to 0
+ * \return the slot index of the element, stable until it is erased*/
+        size_t insert(ElementType *ele, int z = 0) {
+            size_t slot;
+            if (free_slots.empty()) {
+                slot = elements.size();
+                elements.push_back({ele, ele->get_type(), z});
+            } else {
+                slot = free_slots.back();
+                free_slots.pop_back();
+                elements[slot] = {ele, ele->get_type(), z};
+            }
+            insert_order(slot);
+            add_dirty_rect(*ele);
+            hit_valid = false;
+            this->subscribe(this->get_interests() | ele->get_interests());
+            return slot;
+        }
+
+        /*Remove the element from this page, deleting it if the page is independent*/
+        void erase(ElementType *ele) {
+            size_t slot = slot_of(ele);
+            add_dirty_rect(*ele);
+            order.erase(std::find(order.begin(), order.end(), slot));
+            elements[slot].widget = nullptr;
+            free_slots.push_back(slot);
+            hit_valid = false;
+            update_interests();
+            if (independent)
+                delete ele;
+        }
+
+        /*Move the element to another layer, keeping its slot index*/
+        void set_z(ElementType *ele, int z) {
+            size_t slot = slot_of(ele);
+            order.erase(std::find(order.begin(), order.end(), slot));
+            elements[slot].z = z;
+            insert_order(slot);
+            add_dirty_rect(*ele);
+            hit_valid = false;
+        }
+
+        [[nodiscard]] ElementType *at_slot(size_t slot) const {
+            return elements.at(slot).widget;
+        }
+
+        [[nodiscard]] size_t size() const noexcept {
+            return order.size();
+        }
+
+/**
+ * Enable or disable the hit index. When enabled and the manager has a mouse, only the elements under the mouse,
+ captured elements(see WidgetBase::captured()) and the elements left by the mouse in the last frame are processed.
+ * \attention Elements reacting to input other than the mouse when not captured must not be on an indexed page.
+ The index is built again on insert(), erase() and set_z() only, call invalidate_hit_index() after elements move or resize
+ * \param enable whether to enable the index
+ * \param cell_size the size of a grid cell in pixels. Defaults to 64*/
+        void set_hit_index(bool enable, int cell_size = 64) {
+            hit_index = enable;
+            hit_cell = std::max(cell_size, 1);
+            hit_valid = false;
+            hit_keep.clear();
+        }
+
+/**
+ * Compute again the events the page reacts to, from all its elements. insert() adds the events of the new element
+ and erase() calls this, so call it only after an element on the page subscribes to other events.
+ * \attention Otherwise idle() and the event driven mode of parent pages do not see the new events*/
+        void update_interests() noexcept {
+            Uint32 result = ev_none;
+            for (auto index: order)
+                result |= elements[index].widget->get_interests();
+            this->subscribe(result);
+        }
+
+        /*Build the hit index again on the next process(), for elements moved or resized since it was built*/
+        void invalidate_hit_index() noexcept {
+            hit_valid = false;
+        }
+
+/**
+ * Enable or disable the event driven mode. In this mode, an element is processed only if it subscribes to
+ an event received by the manager since its last record(), see WidgetBase::subscribe().
+ Other elements have their results reset as if nothing happened.*/
+        void set_event_driven(bool enable) noexcept {
+            event_driven = enable;
+        }
+
+/**
+ * Whether nothing on the page can change this frame : nothing is dirty, and no element subscribes to the received events or to ev_frame.
+ When idle, the main loop may skip both process() and present(), keeping the last presented frame.
+ * \attention Call after the events of this frame are given to the manager*/
+        [[nodiscard]] bool idle(const MgrType &mgr) const noexcept {
+            return !this->is_dirty() && dirty_rects.empty() &&
+                   ((mgr.events() | ev_frame) & this->get_interests()) == 0;
+        }
+
+        // Nested pages route the input by themselves
+        [[nodiscard]] bool captured() const noexcept override {
+            return true;
         }
 
         WIDGET_DELETES(Page)
@@ -40,18 +332,110 @@ NS_BEGIN
         WIDGET_PROCESS override {
             result.set_type(WidgetResult::t_page);
             auto ele_rel = this->pos + rel;
-            for (auto &ele: elements) {
-                auto widget_result = new WidgetResult();
-                ele.first->process(ele_rel, mgr, *widget_result);
-                result.result.page->insert({ele.first, widget_result});
+            auto &page_results = *result.result.page;
+            // Erased elements must not be found by their pointer, which may be reused by a new element
+            for (auto slot: free_slots)
+                page_results.slot(slot, nullptr);
+            if (hit_index) {
+                if (auto mouse = mouse_of(mgr)) {
+                    process_routed(ele_rel, *mouse, mgr, page_results);
+                    return;
+                }
+            }
+            auto events = frame_events(mgr);
+            for (auto index: order) {
+                auto widget = elements[index].widget;
+                auto &widget_result = page_results.slot(index, widget);
+                if (!(widget->get_interests() & events)) {
+                    widget_result.set_type(elements[index].type);
+                    continue;
+                }
+                widget->process(ele_rel, mgr, widget_result);
+                if (widget->is_dirty())
+                    add_dirty_rect(*widget);
             }
         }
 
         WIDGET_PRESENT override {
             auto ele_rel = this->pos + rel;
-            for (auto &ele: elements) {
-                ele.first->present(renderer, ele_rel);
+            for (auto index: order)
+                elements[index].widget->present(renderer, ele_rel);
+            clear_dirty_elements();
+        }
+
+/**
+ * Present the page through a cached page texture, redrawing only the regions of the elements changed since the last present.
+ Falls back to present() if the renderer cannot render to textures.
+ * \attention Elements must report their view_size() to be redrawn partially, and must not present outside of it*/
+        void present_cached(Renderer &renderer, const Point &rel) {
+            auto page_bounds = bounds();
+            if (!prepare_cache(renderer, page_bounds)) {
+                present(renderer, rel);
+                return;
             }
+            if (!cache_valid || !dirty_rects.empty()) {
+                auto prev_target = renderer.get_target();
+                auto prev_color = renderer.get_color();
+                auto prev_blend = renderer.get_draw_blend();
+                renderer.set_target(*cache);
+                renderer.set_color({0, 0, 0, 0});
+                renderer.set_draw_blend(SDL_BLENDMODE_NONE);
+                if (!cache_valid)
+                    redraw_cache(renderer, page_bounds);
+                else
+                    for (const auto &rect: dirty_rects)
+                        redraw_cache(renderer, rect);
+                renderer.set_clip(nullptr);
+                renderer.set_target(prev_target);
+                renderer.set_color(prev_color);
+                renderer.set_draw_blend(prev_blend);
+                cache_valid = true;
+            }
+            cache->copy_to(renderer, cache_bounds + this->pos + rel);
+            clear_dirty_elements();
+        }
+
+        /*The union of the element areas, relative to this->pos*/
+        [[nodiscard]] Rect bounds() const {
+            Rect result;
+            bool first = true;
+            for (auto index: order) {
+                auto rect = elements[index].widget->view_rect({0, 0});
+                if (rect.empty())
+                    continue;
+                if (first)
+                    result = rect;
+                else
+                    SDL_UnionRect(result, rect, result);
+                first = false;
+            }
+            return result;
+        }
+
+        [[nodiscard]] Point view_size() const override {
+            auto rect = bounds();
+            return rect.rd();
+        }
+
+        /*The regions changed since the last present, relative to this->pos*/
+        [[nodiscard]] const std::vector<Rect> &get_dirty_rects() const noexcept {
+            return dirty_rects;
+        }
+
+        /*The union of get_dirty_rects(), empty if nothing changed*/
+        [[nodiscard]] Rect dirty_union() const {
+            Rect result;
+            for (size_t i = 0; i < dirty_rects.size(); i++) {
+                if (i == 0)
+                    result = dirty_rects[i];
+                else
+                    SDL_UnionRect(result, dirty_rects[i], result);
+            }
+            return result;
+        }
+
+        void clear_dirty() noexcept override {
+            clear_dirty_elements();
         }
 
         WIDGET_TYPE(WidgetResult::t_page);
@@ -62,7 +446,7 @@ NS_BEGIN
     using MouseAndKeyPage = Page<MouseAndKeyClickMgr<KeyType>>;
 
     WIDGET_TEMPLATE(, typename ElementType)
-    class BranchPage : WidgetBase<MgrType> {
+    class BranchPage : public WidgetBase<MgrType> {
     protected:
         WIDGET_TYPEDEFS;
         static_assert(std::is_base_of<WidgetParent, ElementType>::value,
@@ -137,21 +521,43 @@ NS_BEGIN
 
         WIDGET_PROCESS override {
             result.set_type(WidgetResult::t_branch_page);
-            auto sub_result = new WidgetResult();
+            auto &branch_result = *result.result.branch_page;
+            WidgetResult button_result;
             for (auto &pair: branches) {
-                pair.first->process(rel, mgr, *sub_result);
-                if (sub_result->result.button.released)
+                pair.first->process(rel, mgr, button_result);
+                if (button_result.result.button.released && cur_branch != pair.first) {
                     cur_branch = pair.first;
+                    this->mark_dirty();
+                }
+                if (pair.first->is_dirty())
+                    this->mark_dirty();
             }
-            result.result.branch_page->key = cur_branch;
-            branches.at(cur_branch)->process(rel, mgr, *sub_result);
-            result.result.branch_page->sub_res = sub_result;
+            branch_result.key = cur_branch;
+            if (branch_result.sub_res == nullptr)
+                branch_result.sub_res = new WidgetResult();
+            auto cur_page = branches.at(cur_branch);
+            cur_page->process(rel, mgr, *branch_result.sub_res);
+            if (cur_page->is_dirty())
+                this->mark_dirty();
         }
 
         WIDGET_PRESENT override {
             for (auto &pair: branches)
                 pair.first->present(renderer, rel);
             branches.at(cur_branch)->present(renderer, rel);
+            clear_dirty();
+        }
+
+        [[nodiscard]] bool captured() const noexcept override {
+            return true;
+        }
+
+        void clear_dirty() noexcept override {
+            for (auto &pair: branches) {
+                pair.first->clear_dirty();
+                pair.second->clear_dirty();
+            }
+            WidgetParent::clear_dirty();
         }
 
         WIDGET_TYPE(WidgetResult::t_branch_page)
@@ -8,6 +8,7 @@
 #include "ExtBase.h"
 #include "ExtWidget.hpp"
 #include "ExtWidgetButton.hpp"
+#include "ExtWidgetChrome.hpp"
 
 #define IF_VERT(spec, typen) template<bool vertical_=vertical> \
 spec typename std::enable_if<vertical_, typen>::type
@@ -31,14 +32,16 @@ NS_BEGIN
     protected:
         WIDGET_TYPEDEFS
         using DragInput = long double (*)(const MgrType &, const Rect &, PointRef, const Rect &, bool);
-        Point real_size, scroll_size, button_rel;
+        Point real_size, scroll_size, button_rel, background_rel;
         Button<MgrType> *button;
         long double percentage;
 
         ConstSchemeRef scheme;
 
         DragInput drag_input;
-        Surface *back = nullptr;
+        Chrome chrome;
+        NumType outline_size;
+        WidgetImage background;
 
         IF_VERT(, void)
         set_button_pos() {
@@ -70,22 +73,22 @@ NS_BEGIN
             scroll_size = {real_size.x - but_len, real_size.y};
         }
 
-        template<typename MgrType_=MgrType, typename KeyType>
+        template<typename MgrType_=MgrType, typename KeyType = SDL_Keycode>
         static typename std::enable_if<std::is_same<MgrType_, MouseMgr>::value, long double>::type
         mouse_scroll_input(const MouseMgr &mgr, const Rect &but_rect, PointRef, const Rect &bar_rect,
                            bool but_is_front) {
             if (bar_rect.contains(mgr.at(MouseMgr::pos)) && mgr.wheel_moved())
-                return mgr.wheel_rel.y / -100.0;
+                return mgr.wheel_precise.y / -100.0;
             return 0;
         }
 
-        template<typename MgrType_=MgrType, typename KeyType>
+        template<typename MgrType_=MgrType, typename KeyType = SDL_Keycode>
         static typename std::enable_if<std::is_same<MgrType_, MouseAndKeyClickMgr<KeyType>>::value, long double>::type
         mouse_scroll_input(const MouseAndKeyClickMgr<KeyType> &mgr, const Rect &but_rect, PointRef,
                            const Rect &bar_rect,
                            bool but_is_front) {
             if (bar_rect.contains(mgr.mouse.at(MouseMgr::pos)) && mgr.mouse.wheel_moved())
-                return mgr.mouse.wheel_rel.y / -100.0;
+                return mgr.mouse.wheel_precise.y / -100.0;
             return 0;
         }
 
@@ -159,19 +162,15 @@ NS_BEGIN
                   const Point *background_pos = nullptr, ConstSchemeRef scheme = scheme_bright,
                   DragInput drag_input = mouse_drag_and_scroll_input) :
                 WidgetParent{pos}, real_size(size), percentage(init_percentage),
-                scheme(scheme), drag_input(drag_input) {
+                scheme(scheme), drag_input(drag_input),
+                chrome(scheme), outline_size(outline_size), background(background) {
+            if (drag_input == DragInput(mouse_drag_and_scroll_input))
+                this->subscribe(ev_mouse);
             set_button_pos();
-            back = new Surface(size);
-            back->fill_rect(scheme.front_outline);
-            back->fill_rect(scheme.front_body,
-                            Rect{outline_size, outline_size,
-                                 size.x - outline_size * 2, size.y - outline_size * 2});
             if (background != nullptr) {
-                Point background_rel;
                 if (background_pos == nullptr)
                     background_rel = {(size.x - background->w) / 2, (size.y - background->h) / 2};
                 else background_rel = *background_pos;
-                back->blit(background, background_rel);
             }
         }
 
@@ -186,7 +185,6 @@ NS_BEGIN
 
 
         ~Scrollbar() override {
-            delete back;
             delete button;
         }
 
@@ -199,20 +197,40 @@ NS_BEGIN
                                    {real.x, real.y, real_size.x, real_size.y},
                                    button->is_front);
             if (drag != 0) {
+                auto prev = percentage;
                 percentage += drag;
                 if (percentage < 0) percentage = 0;
                 else if (percentage > 1) percentage = 1;
+                if (percentage != prev)
+                    this->mark_dirty();
             }
             set_button_pos();
             {
                 WidgetResult button_result;
                 button->process(button_rel + rel, mgr, button_result);
             }
+            if (button->is_dirty())
+                this->mark_dirty();
             result.result.scrollbar.percentage = percentage;
         }
 
+        [[nodiscard]] Point view_size() const override {
+            return real_size;
+        }
+
+        [[nodiscard]] bool captured() const noexcept override {
+            return button->is_front;
+        }
+
+        void clear_dirty() noexcept override {
+            WidgetParent::clear_dirty();
+            button->clear_dirty();
+        }
+
         WIDGET_PRESENT override {
-            back->copy_to(renderer, this->pos + rel);
+            auto real = this->pos + rel;
+            chrome.copy_to(renderer, {real.x, real.y, real_size.x, real_size.y}, outline_size, Chrome::front);
+            background.copy_to(renderer, this->pos + background_rel + rel);
             button->present(renderer, button_rel + rel);
         }
 
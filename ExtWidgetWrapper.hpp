@@ -30,8 +30,17 @@ NS_BEGIN
 
         WIDGET_DELETES(Wrapper)
 
+        // The wrapped object may change on its own, so it is always dirty
         WIDGET_PROCESS override {
             result.set_type(WidgetResult::t_wrapper);
+            this->mark_dirty();
+        }
+
+        [[nodiscard]] Point view_size() const override {
+            if constexpr (requires { Point(obj.size()); })
+                return obj.size();
+            else
+                return {0, 0};
         }
 
         WIDGET_PRESENT override {
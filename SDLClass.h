@@ -8,8 +8,14 @@
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <algorithm>
 #include <type_traits>
 #include <iostream>
+#include <atomic>
 #include "SDL.h"
 #include "SDL_image.h"
 #include "SDL_ttf.h"
@@ -493,7 +499,200 @@ type &operator=(type &&) = delete;
 
     class Renderer {
     protected:
+        struct CachedTexture {
+            SDLTexturePtr texture;
+            Uint64 stamp, last_used;
+        };
+
+        struct PooledTexture {
+            SDLTexturePtr texture;
+            int w, h;
+            Uint64 last_used;
+        };
+
+        struct DrawCommand {
+            SDLTexturePtr texture;
+            SDL_BlendMode blend_mode;
+            SDL_Color color;
+            SDL_FRect uv, dst;
+            // The batch the copy is drawn in, see order_batches()
+            size_t batch;
+        };
+
+        struct Batch {
+            SDLTexturePtr texture;
+            SDL_BlendMode blend_mode;
+        };
+
         SDLRendererPtr renderer;
+        /*Textures uploaded from surfaces, keyed by the surface pointer and validated by the surface stamp*/
+        std::unordered_map<ConstSDLSurfacePtr, CachedTexture> texture_cache;
+        /*Streaming textures recycled by copy(SDLSurfacePtr, ...), each used at most once per frame*/
+        std::vector<PooledTexture> upload_pool;
+        size_t upload_pool_size = 16;
+        Uint64 frame = 0, cache_lifetime = 120;
+        /*Copies recorded in deferred mode, submitted by flush()*/
+        std::vector<DrawCommand> draw_queue;
+        std::vector<SDL_Vertex> vertices;
+        std::vector<int> indices;
+        std::vector<Batch> batches;
+        // A grid over the queued copies, holding the indices of the copies in each cell
+        std::vector<std::vector<size_t>> draw_cells;
+        bool deferred = false;
+
+        void record(SDLTexturePtr texture, const SDL_Rect *srcrect, const SDL_Rect *dstrect) {
+            int w, h;
+            if (SDL_QueryTexture(texture, nullptr, nullptr, &w, &h) != 0 || w == 0 || h == 0)
+                return;
+            DrawCommand command{texture, SDL_BLENDMODE_NONE, {}, {}, {}, 0};
+            SDL_GetTextureBlendMode(texture, &command.blend_mode);
+            SDL_GetTextureColorMod(texture, &command.color.r, &command.color.g, &command.color.b);
+            SDL_GetTextureAlphaMod(texture, &command.color.a);
+            SDL_Rect src = srcrect ? *srcrect : SDL_Rect{0, 0, w, h};
+            command.uv = {static_cast<float>(src.x) / w, static_cast<float>(src.y) / h,
+                          static_cast<float>(src.w) / w, static_cast<float>(src.h) / h};
+            SDL_Rect dst;
+            if (dstrect)
+                dst = *dstrect;
+            else {
+                SDL_RenderGetViewport(renderer, &dst);
+                dst.x = dst.y = 0;
+            }
+            command.dst = {static_cast<float>(dst.x), static_cast<float>(dst.y),
+                           static_cast<float>(dst.w), static_cast<float>(dst.h)};
+            draw_queue.push_back(command);
+        }
+
+        void submit(const DrawCommand *begin, const DrawCommand *end) {
+            vertices.clear();
+            indices.clear();
+            for (auto command = begin; command != end; ++command) {
+                const auto &dst = command->dst, &uv = command->uv;
+                int base = static_cast<int>(vertices.size());
+                vertices.push_back({{dst.x, dst.y}, command->color, {uv.x, uv.y}});
+                vertices.push_back({{dst.x + dst.w, dst.y}, command->color, {uv.x + uv.w, uv.y}});
+                vertices.push_back({{dst.x + dst.w, dst.y + dst.h}, command->color, {uv.x + uv.w, uv.y + uv.h}});
+                vertices.push_back({{dst.x, dst.y + dst.h}, command->color, {uv.x, uv.y + uv.h}});
+                for (int index: {0, 1, 2, 0, 2, 3})
+                    indices.push_back(base + index);
+            }
+            // Leave the texture with the blend mode its owner set, which may differ from the one recorded
+            SDL_BlendMode prev_blend;
+            SDL_GetTextureBlendMode(begin->texture, &prev_blend);
+            SDL_SetTextureBlendMode(begin->texture, begin->blend_mode);
+            SDL_RenderGeometry(renderer, begin->texture, vertices.data(), static_cast<int>(vertices.size()),
+                               indices.data(), static_cast<int>(indices.size()));
+            SDL_SetTextureBlendMode(begin->texture, prev_blend);
+        }
+
+        static bool overlaps(const SDL_FRect &a, const SDL_FRect &b) noexcept {
+            return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+        }
+
+/* Put every queued copy in a batch of its texture and blend mode, the batches are drawn in order.
+ * A copy joins the last batch of its kind unless it overlaps a copy of another kind queued after that batch began,
+ so copies are only moved where they overlap nothing and the painter order is kept.
+ * The copies overlapping are found through a grid, so a frame of copies far apart takes linear time*/
+        void order_batches() {
+            batches.clear();
+            float left = draw_queue.front().dst.x, top = draw_queue.front().dst.y, right = left, bottom = top;
+            for (const auto &command: draw_queue) {
+                left = std::min(left, command.dst.x);
+                top = std::min(top, command.dst.y);
+                right = std::max(right, command.dst.x + command.dst.w);
+                bottom = std::max(bottom, command.dst.y + command.dst.h);
+            }
+            const int max_cells = 128;
+            float cell = std::max({64.0f, (right - left) / max_cells, (bottom - top) / max_cells});
+            int cols = static_cast<int>((right - left) / cell) + 1, rows = static_cast<int>((bottom - top) / cell) + 1;
+            if (draw_cells.size() < static_cast<size_t>(cols * rows))
+                draw_cells.resize(static_cast<size_t>(cols * rows));
+            for (int i = 0; i < cols * rows; i++)
+                draw_cells[i].clear();
+            for (size_t i = 0; i < draw_queue.size(); i++) {
+                auto &command = draw_queue[i];
+                const auto &dst = command.dst;
+                int col_begin = static_cast<int>((dst.x - left) / cell),
+                        col_end = static_cast<int>((dst.x + dst.w - left) / cell),
+                        row_begin = static_cast<int>((dst.y - top) / cell),
+                        row_end = static_cast<int>((dst.y + dst.h - top) / cell);
+                // The first batch the copy may be drawn in, after every batch of the copies it overlaps
+                size_t min_batch = 0;
+                for (int row = row_begin; row <= row_end; row++)
+                    for (int col = col_begin; col <= col_end; col++)
+                        for (auto prev: draw_cells[row * cols + col]) {
+                            const auto &other = draw_queue[prev];
+                            if (!overlaps(dst, other.dst))
+                                continue;
+                            bool same = other.texture == command.texture && other.blend_mode == command.blend_mode;
+                            min_batch = std::max(min_batch, other.batch + (same ? 0 : 1));
+                        }
+                command.batch = batches.size();
+                for (size_t batch = batches.size(); batch-- > min_batch;)
+                    if (batches[batch].texture == command.texture && batches[batch].blend_mode == command.blend_mode) {
+                        command.batch = batch;
+                        break;
+                    }
+                if (command.batch == batches.size())
+                    batches.push_back({command.texture, command.blend_mode});
+                for (int row = row_begin; row <= row_end; row++)
+                    for (int col = col_begin; col <= col_end; col++)
+                        draw_cells[row * cols + col].push_back(i);
+            }
+        }
+
+        // Textures that may still be queued must not be destroyed before the queue is submitted
+        void flush_before_destroy() {
+            if (!draw_queue.empty())
+                flush();
+        }
+
+        void sweep_texture_cache() noexcept {
+            for (auto iter = texture_cache.begin(); iter != texture_cache.end();) {
+                if (frame - iter->second.last_used > cache_lifetime) {
+                    SDL_DestroyTexture(iter->second.texture);
+                    iter = texture_cache.erase(iter);
+                } else ++iter;
+            }
+        }
+
+        // Find a streaming texture of the size that is not used in this frame, creating or replacing one if needed
+        SDLTexturePtr pooled_texture(int w, int h) {
+            PooledTexture *oldest = nullptr;
+            for (auto &pooled: upload_pool) {
+                if (pooled.last_used == frame)
+                    continue;
+                if (pooled.w == w && pooled.h == h) {
+                    pooled.last_used = frame;
+                    return pooled.texture;
+                }
+                if (oldest == nullptr || pooled.last_used < oldest->last_used)
+                    oldest = &pooled;
+            }
+            auto texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, w, h);
+            if (texture == nullptr)
+                return nullptr;
+            if (upload_pool.size() >= upload_pool_size && oldest != nullptr) {
+                SDL_DestroyTexture(oldest->texture);
+                *oldest = {texture, w, h, frame};
+            } else
+                upload_pool.push_back({texture, w, h, frame});
+            return texture;
+        }
+
+        // Destroy the least recently used streaming textures above upload_pool_size, after the frame is submitted
+        void trim_upload_pool() noexcept {
+            if (upload_pool.size() <= upload_pool_size)
+                return;
+            std::sort(upload_pool.begin(), upload_pool.end(), [](const PooledTexture &a, const PooledTexture &b) {
+                return a.last_used > b.last_used;
+            });
+            for (auto iter = upload_pool.begin() + static_cast<std::ptrdiff_t>(upload_pool_size);
+                 iter != upload_pool.end(); ++iter)
+                SDL_DestroyTexture(iter->texture);
+            upload_pool.resize(upload_pool_size);
+        }
+
     public:
         Renderer(WindowPtr window, int index, Uint32 flags) : renderer(SDL_CreateRenderer(window, index, flags)) {}
 
@@ -504,37 +703,219 @@ type &operator=(type &&) = delete;
         NO_COPY(Renderer)
 
         void destroy() noexcept {
+            clear_texture_cache();
+            clear_upload_pool();
             SDL_DestroyRenderer(renderer);
             renderer = nullptr;
         }
 
+/**
+ * Get the texture uploaded from \c surface, uploading it only if it is not cached or \c stamp has changed.
+ * \param surface the surface to upload
+ * \param stamp the version of the surface content, see \c SurfaceBase::touch(). 0 for surfaces never modified
+ * \return the texture, which is owned by the renderer*/
+        SDLTexturePtr cached_texture(SDLSurfacePtr surface, Uint64 stamp) {
+            auto iter = texture_cache.find(surface);
+            if (iter != texture_cache.end()) {
+                auto &cached = iter->second;
+                cached.last_used = frame;
+                if (cached.stamp == stamp)
+                    return cached.texture;
+                flush_before_destroy();
+                SDL_DestroyTexture(cached.texture);
+                cached.texture = SDL_CreateTextureFromSurface(renderer, surface);
+                cached.stamp = stamp;
+                auto texture = cached.texture;
+                // A failed upload is not cached, so it is tried again next time
+                if (texture == nullptr)
+                    texture_cache.erase(iter);
+                return texture;
+            }
+            auto texture = SDL_CreateTextureFromSurface(renderer, surface);
+            if (texture != nullptr)
+                texture_cache.insert({surface, {texture, stamp, frame}});
+            return texture;
+        }
+
+        void release_texture(ConstSDLSurfacePtr surface) {
+            auto iter = texture_cache.find(surface);
+            if (iter != texture_cache.end()) {
+                flush_before_destroy();
+                SDL_DestroyTexture(iter->second.texture);
+                texture_cache.erase(iter);
+            }
+        }
+
+        void clear_texture_cache() noexcept {
+            draw_queue.clear();
+            for (auto &pair: texture_cache)
+                SDL_DestroyTexture(pair.second.texture);
+            texture_cache.clear();
+        }
+
+        /*Cached textures that are not used for this many presented frames are destroyed, at least 1*/
+        void set_cache_lifetime(Uint64 frames) noexcept {
+            cache_lifetime = std::max<Uint64>(frames, 1);
+        }
+
+/**
+ * Upload \c surface into a pooled streaming texture, which is valid until the end of this frame.
+ * \param surface the surface to upload, converted to \c SDL_PIXELFORMAT_ARGB8888 if needed,
+ or if it has a color key, which the conversion turns into alpha
+ * \return the texture, owned by the renderer, or \c nullptr on failure*/
+        SDLTexturePtr upload(SDLSurfacePtr surface) {
+            SDLSurfacePtr converted = nullptr;
+            if (surface->format->format != SDL_PIXELFORMAT_ARGB8888 || SDL_HasColorKey(surface)) {
+                converted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+                if (converted == nullptr)
+                    return nullptr;
+            }
+            auto source = converted ? converted : surface;
+            auto texture = pooled_texture(source->w, source->h);
+            if (texture != nullptr) {
+                if (SDL_MUSTLOCK(source))
+                    SDL_LockSurface(source);
+                SDL_UpdateTexture(texture, nullptr, source->pixels, source->pitch);
+                if (SDL_MUSTLOCK(source))
+                    SDL_UnlockSurface(source);
+                Uint8 r, g, b, a;
+                SDL_BlendMode blend_mode;
+                SDL_GetSurfaceColorMod(surface, &r, &g, &b);
+                SDL_GetSurfaceAlphaMod(surface, &a);
+                SDL_GetSurfaceBlendMode(surface, &blend_mode);
+                if (SDL_HasColorKey(surface))
+                    blend_mode = SDL_BLENDMODE_BLEND;
+                SDL_SetTextureColorMod(texture, r, g, b);
+                SDL_SetTextureAlphaMod(texture, a);
+                SDL_SetTextureBlendMode(texture, blend_mode);
+            }
+            SDL_FreeSurface(converted);
+            return texture;
+        }
+
+        /*At most this many streaming textures are kept for surface uploads between frames.
+         * More may be created within a frame uploading more surfaces, the extra ones are destroyed by present()*/
+        void set_upload_pool_size(size_t size) noexcept {
+            upload_pool_size = size;
+        }
+
+        void clear_upload_pool() noexcept {
+            draw_queue.clear();
+            for (auto &pooled: upload_pool)
+                SDL_DestroyTexture(pooled.texture);
+            upload_pool.clear();
+        }
+
         [[nodiscard]] constexpr SDLRendererPtr ptr() const noexcept {
             return renderer;
         }
 
+        // The surface is uploaded into a pooled texture, use SurfaceBase::copy_to() for surfaces drawn every frame
         void copy(SDLSurfacePtr surface, const SDL_Rect *srcrect, const SDL_Rect *dstrect) {
-            auto texture = SDL_CreateTextureFromSurface(renderer, surface);
-            copy(texture, srcrect, dstrect);
+            auto texture = upload(surface);
+            if (texture != nullptr)
+                copy(texture, srcrect, dstrect);
         }
 
         void copy(SDLTexturePtr texture, const SDL_Rect *srcrect = nullptr, const SDL_Rect *dstrect = nullptr) {
-            SDL_RenderCopy(renderer, texture, srcrect, dstrect);
+            if (deferred)
+                record(texture, srcrect, dstrect);
+            else
+                SDL_RenderCopy(renderer, texture, srcrect, dstrect);
+        }
+
+/**
+ * Enable or disable deferred mode. In deferred mode, copies are recorded and submitted on flush() or present(),
+ grouped by texture and blend mode and drawn with one \c SDL_RenderGeometry call per group.
+ Copies are moved to an earlier group of their texture only over copies they do not overlap, so the result is
+ the same as drawing them in order.
+ * \attention Textures copied must stay alive until they are submitted.*/
+        void set_deferred(bool enable) {
+            if (!enable)
+                flush();
+            deferred = enable;
+        }
+
+        [[nodiscard]] constexpr bool is_deferred() const noexcept {
+            return deferred;
+        }
+
+        /*Submit all the copies recorded in deferred mode*/
+        void flush() {
+            if (draw_queue.empty())
+                return;
+            order_batches();
+            std::stable_sort(draw_queue.begin(), draw_queue.end(), [](const DrawCommand &a, const DrawCommand &b) {
+                return a.batch < b.batch;
+            });
+            auto begin = draw_queue.data(), end = begin + draw_queue.size();
+            while (begin != end) {
+                auto run_end = begin + 1;
+                while (run_end != end && run_end->batch == begin->batch)
+                    ++run_end;
+                submit(begin, run_end);
+                begin = run_end;
+            }
+            draw_queue.clear();
         }
 
         int set_color(const SDL_Color &color) const {
             return SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
         }
 
-        int clear() const {
+        [[nodiscard]] SDL_Color get_color() const {
+            SDL_Color color;
+            SDL_GetRenderDrawColor(renderer, &color.r, &color.g, &color.b, &color.a);
+            return color;
+        }
+
+        int set_draw_blend(SDL_BlendMode blendMode) const {
+            return SDL_SetRenderDrawBlendMode(renderer, blendMode);
+        }
+
+        [[nodiscard]] SDL_BlendMode get_draw_blend() const {
+            SDL_BlendMode blend_mode;
+            SDL_GetRenderDrawBlendMode(renderer, &blend_mode);
+            return blend_mode;
+        }
+
+        // Drawing and render states apply in order with the copies queued in deferred mode, so the queue is flushed first
+
+        int fill_rect(const SDL_Rect *rect = nullptr) {
+            flush();
+            return SDL_RenderFillRect(renderer, rect);
+        }
+
+        int set_target(SDLTexturePtr texture) {
+            flush();
+            return SDL_SetRenderTarget(renderer, texture);
+        }
+
+        [[nodiscard]] SDLTexturePtr get_target() const {
+            return SDL_GetRenderTarget(renderer);
+        }
+
+        int set_clip(const SDL_Rect *rect) {
+            flush();
+            return SDL_RenderSetClipRect(renderer, rect);
+        }
+
+        int clear() {
+            flush();
             return SDL_RenderClear(renderer);
         }
 
-        int set_logical_size(Point::PointRef size) const {
+        int set_logical_size(Point::PointRef size) {
+            flush();
             return SDL_RenderSetLogicalSize(renderer, size.x, size.y);
         }
 
-        void present() const {
+        void present() {
+            flush();
             SDL_RenderPresent(renderer);
+            trim_upload_pool();
+            if (++frame % cache_lifetime == 0)
+                sweep_texture_cache();
         }
 
         constexpr operator SDLRendererPtr() const noexcept { // NOLINT(google-explicit-constructor)
@@ -581,6 +962,10 @@ type &operator=(type &&) = delete;
             SDL_SetTextureBlendMode(texture, blendMode);
         }
 
+        void set_color(const SDL_Color &color) {
+            SDL_SetTextureColorMod(texture, color.r, color.g, color.b);
+        }
+
         constexpr operator SDLTexturePtr() const noexcept { // NOLINT(google-explicit-constructor)
             return ptr();
         }
@@ -590,6 +975,9 @@ type &operator=(type &&) = delete;
     public:
         Texture() : TextureBase() {}
 
+        // The texture IS managed and will be destroyed on delete.
+        explicit Texture(SDLTexturePtr texture) noexcept: TextureBase(texture) {}
+
         Texture(SDLRendererPtr renderer, SDLSurfacePtr surface) noexcept {
             texture = SDL_CreateTextureFromSurface(renderer, surface);
         } // NOLINT(google-explicit-constructor
@@ -602,12 +990,21 @@ type &operator=(type &&) = delete;
     class SurfaceBase {
     protected:
         SDLSurfacePtr surface;
+        /*A process-wide unique version of the surface content, used by the renderer texture cache*/
+        mutable Uint64 stamp;
+
     public:
+        /*A process-wide unique stamp, never 0*/
+        static Uint64 next_stamp() noexcept {
+            static std::atomic<Uint64> counter{0};
+            return ++counter;
+        }
 
-        SurfaceBase() noexcept: surface(nullptr) {}
+
+        SurfaceBase() noexcept: surface(nullptr), stamp(next_stamp()) {}
 
         SurfaceBase(SDLSurfacePtr surface) noexcept:// NOLINT(google-explicit-constructor)
-                surface(surface) {}
+                surface(surface), stamp(next_stamp()) {}
 
         virtual ~SurfaceBase() = default;
 
@@ -616,6 +1013,17 @@ type &operator=(type &&) = delete;
         void free() noexcept {
             SDL_FreeSurface(surface);
             surface = nullptr;
+            touch();
+        }
+
+        /*Mark the content as changed, so the texture cached by renderers will be uploaded again.
+         * Call this after modifying the pixels through ptr() directly*/
+        void touch() const noexcept {
+            stamp = next_stamp();
+        }
+
+        [[nodiscard]] constexpr Uint64 get_stamp() const noexcept {
+            return stamp;
         }
 
         [[nodiscard]] constexpr SDLSurfacePtr ptr() const noexcept {
@@ -635,8 +1043,7 @@ type &operator=(type &&) = delete;
         }
 
         void copy_to(Renderer &renderer, Point::PointRef dst) const {
-            Texture texture{renderer, surface};
-            texture.copy_to(renderer, Rect{surface, dst});
+            renderer.copy(renderer.cached_texture(surface, stamp), nullptr, Rect{surface, dst});
         }
 
         void copy_by_center_to(Renderer &renderer, Point::PointRef center) const {
@@ -644,45 +1051,53 @@ type &operator=(type &&) = delete;
         }
 
         void copy_to(Renderer &renderer, const SDL_Rect *dstrect) const {
-            Texture texture{renderer, surface};
-            texture.copy_to(renderer, dstrect);
+            renderer.copy(renderer.cached_texture(surface, stamp), nullptr, dstrect);
         }
 
         void blit(SDLSurfacePtr a_surface, const Point &dst) const {
             Rect dstrect = Rect(a_surface) + dst;
             SDL_BlitSurface(a_surface, nullptr, surface, &dstrect);
+            touch();
         }
 
         void blit(SDLSurfacePtr a_surface, SDL_Rect *dstrect = nullptr) const {
             SDL_BlitSurface(a_surface, nullptr, surface, dstrect);
+            touch();
         }
 
         void blit(SDLSurfacePtr a_surface, const SDL_Rect *srcrect, SDL_Rect *dstrect) const {
             SDL_BlitSurface(a_surface, srcrect, surface, dstrect);
+            touch();
         }
 
         void lower_blit(SDLSurfacePtr a_surface, SDL_Rect *srcrect, SDL_Rect *dstrect) const {
             SDL_LowerBlit(a_surface, srcrect, surface, dstrect);
+            touch();
         }
 
         void set_color_key(const SDL_Color &color, int flag = SDL_TRUE) {
             SDL_SetColorKey(surface, flag, get_color(color));
+            touch();
         }
 
         void set_alpha(Uint8 alpha) const {
             SDL_SetSurfaceAlphaMod(surface, alpha);
+            touch();
         }
 
         void set_blend(SDL_BlendMode blendMode) const {
             SDL_SetSurfaceBlendMode(surface, blendMode);
+            touch();
         }
 
         void lock() const {
             SDL_LockSurface(surface);
         }
 
+        // The pixels may be written while locked, so the content is considered changed
         void unlock() const {
             SDL_UnlockSurface(surface);
+            touch();
         }
 
         SDLSurfacePtr merge_x(SurfaceBase &a_surface) const {
@@ -713,6 +1128,7 @@ type &operator=(type &&) = delete;
 
         void fill_rect(const SDL_Color &color, const SDL_Rect *rect = nullptr) const {
             SDL_FillRect(surface, rect, get_color(color));
+            touch();
         }
 
         operator SDLSurfacePtr() const { // NOLINT(google-explicit-constructor)
@@ -760,10 +1176,26 @@ type &operator=(type &&) = delete;
 
         Font &operator=(const Font &) = delete;
 
+        [[nodiscard]] constexpr FontPtr ptr() const noexcept {
+            return font;
+        }
+
         [[nodiscard]] int height() const {
             return TTF_FontHeight(font);
         }
 
+        [[nodiscard]] int line_skip() const {
+            return TTF_FontLineSkip(font);
+        }
+
+        [[nodiscard]] int get_style() const {
+            return TTF_GetFontStyle(font);
+        }
+
+        [[nodiscard]] int get_outline() const {
+            return TTF_GetFontOutline(font);
+        }
+
         [[nodiscard]] int is_fixed_width() const {
             return TTF_FontFaceIsFixedWidth(font);
         }
@@ -785,6 +1217,24 @@ type &operator=(type &&) = delete;
         }
 
 
+        /*The size of the UTF-8 text rendered in a single line*/
+        [[nodiscard]] Point size(const std::string &text) const {
+            Point result;
+            TTF_SizeUTF8(font, text.c_str(), &result.x, &result.y);
+            return result;
+        }
+
+        /*The number of UTF-8 characters of text fitting in width pixels, the width they take is written to extent*/
+        int measure(const std::string &text, int width, int *extent = nullptr) const {
+            int count = 0;
+            TTF_MeasureUTF8(font, text.c_str(), width, extent, &count);
+            return count;
+        }
+
+        SDLSurfacePtr render_glyph(Uint32 codepoint, const SDL_Color &color) {
+            return TTF_RenderGlyph32_Blended(font, codepoint, color);
+        }
+
         SDLSurfacePtr render(const std::string &text, const SDL_Color &color) {
             return TTF_RenderUTF8_Blended(font, text.c_str(), color);
         }
@@ -802,43 +1252,118 @@ type &operator=(type &&) = delete;
         }
     };
 
+/*A font file opened at different sizes. Sizes are opened on demand and shared,
+ the least recently used sizes are closed once more than capacity sizes are open.
+ * All the member functions are thread safe, but a Font itself must not be used from two threads at once*/
     class FontFamily {
     protected:
+        using FontRef = std::shared_ptr<Font>;
+        using UsageList = std::list<int>;
+
+        struct FontEntry {
+            FontRef font;
+            UsageList::iterator usage;
+        };
+
         std::string file;
-        std::unordered_map<int, Font *> fonts;
-    public:
-        explicit FontFamily(const std::string &a_file) {
-            file = a_file;
+        std::unordered_map<int, FontEntry> fonts;
+        // The most recently used size is at the front
+        UsageList usage;
+        size_t capacity;
+        mutable std::mutex mutex;
+
+        FontRef use(FontEntry &entry) {
+            usage.splice(usage.begin(), usage, entry.usage);
+            return entry.font;
         }
 
-        void close(int size) {
-            fonts.erase(size);
+        void shrink() {
+            while (fonts.size() > capacity && !usage.empty()) {
+                fonts.erase(usage.back());
+                usage.pop_back();
+            }
         }
 
-        Font &get(int size) noexcept {
-            try {
-                return at(size);
-            } catch (const std::out_of_range &) {
-                return create(size);
+        FontRef open(int size) {
+            auto font = std::make_shared<Font>(file, size);
+            auto iter = fonts.find(size);
+            if (iter != fonts.end()) {
+                iter->second.font = font;
+                use(iter->second);
+            } else {
+                usage.push_front(size);
+                fonts.insert({size, {font, usage.begin()}});
+                shrink();
             }
+            return font;
         }
 
-        Font &operator[](int size) noexcept {
-            try {
-                return at(size);
-            } catch (const std::out_of_range &) {
-                return create(size);
+    public:
+/**
+ * \param a_file the font file
+ * \param capacity the max count of sizes kept open. Defaults to 16*/
+        explicit FontFamily(std::string a_file, size_t capacity = 16) :
+                file(std::move(a_file)), capacity(std::max<size_t>(capacity, 1)) {}
+
+        FontFamily(const FontFamily &) = delete;
+
+        FontFamily &operator=(const FontFamily &) = delete;
+
+        /*Stop caching the size, the font is closed when no one else shares it*/
+        void close(int size) {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto iter = fonts.find(size);
+            if (iter != fonts.end()) {
+                usage.erase(iter->second.usage);
+                fonts.erase(iter);
             }
         }
 
-        Font &at(int size) {
-            return *fonts.at(size);
+        /*Get the font of the size, opening it if needed*/
+        FontRef get(int size) {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto iter = fonts.find(size);
+            if (iter != fonts.end())
+                return use(iter->second);
+            return open(size);
+        }
+
+        FontRef operator[](int size) {
+            return get(size);
+        }
+
+        /*Get the font of the size if it is open, otherwise nullptr*/
+        FontRef find(int size) {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto iter = fonts.find(size);
+            if (iter != fonts.end())
+                return use(iter->second);
+            return nullptr;
+        }
+
+        /*Get the font of the size if it is open, otherwise throw std::out_of_range*/
+        FontRef at(int size) {
+            auto font = find(size);
+            if (!font)
+                throw std::out_of_range("Font of file \"" + file + "\" sized " + std::to_string(size) + " is not open");
+            return font;
+        }
+
+        /*Open the font of the size again, replacing the cached one*/
+        FontRef create(int size) {
+            std::lock_guard<std::mutex> lock(mutex);
+            return open(size);
+        }
+
+        void set_capacity(size_t new_capacity) {
+            std::lock_guard<std::mutex> lock(mutex);
+            capacity = std::max<size_t>(new_capacity, 1);
+            shrink();
         }
 
-        Font &create(int size) noexcept {
-            auto new_font = new Font{file, size};
-            fonts.insert({size, new_font});
-            return *new_font;
+        [[nodiscard]] size_t size() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return fonts.size();
         }
     };
 
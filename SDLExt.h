@@ -10,14 +10,21 @@
 #include "ExtMath.hpp"
 #include "ExtColor.hpp"
 #include "ExtKeyMgr.hpp"
+#include "ExtInputQueue.hpp"
 #include "ExtWidget.hpp"
+#include "ExtWidgetChrome.hpp"
 #include "ExtWidgetButton.hpp"
 #include "ExtWidgetPage.hpp"
 #include "ExtWidgetInputBox.hpp"
 #include "ExtWidgetScrollbar.hpp"
 #include "ExtWidgetWrapper.hpp"
 #include "ExtWidgetGenerate.hpp"
+#include "ExtAtlas.hpp"
+#include "ExtUTF8.hpp"
+#include "ExtGapBuffer.hpp"
+#include "ExtGlyphCache.hpp"
 #include "ExtFrameArray.hpp"
+#include "ExtInputReplay.hpp"
 
 #ifdef UNDEF_MACROS
 #undef UNDEF_MACROS
@@ -0,0 +1,71 @@
+//
+// Created by Dogs-Cute on 10/17/2026.
+//
+
+/*Compares processing a page of buttons with and without the hit index (Page::set_hit_index()),
+ * replaying the same recorded mouse input on a headless renderer for 100 to 10000 buttons.
+ * Build : g++ -std=gnu++20 -O2 -I.. HitIndexBenchmark.cpp ../SDL2_rotozoom.c -lSDL2 -lSDL2_image -lSDL2_ttf*/
+
+#include <cstdio>
+
+#include "../SDLExt.h"
+
+using namespace SDLClass;
+using namespace SDLExt;
+
+constexpr int button_size = 6, frames = 300;
+
+// The mouse moves diagonally across the page every other frame, clicking every 50 frames and idle otherwise
+InputLog mouse_log(int page_size) {
+    InputRecorder recorder;
+    SDL_Event event{};
+    Point prev{0, 0};
+    for (int frame = 0; frame < frames; frame++) {
+        if (frame % 2 == 0) {
+            int offset = frame * page_size / frames;
+            event.type = SDL_MOUSEMOTION;
+            event.motion.x = offset;
+            event.motion.y = offset;
+            event.motion.xrel = offset - prev.x;
+            event.motion.yrel = offset - prev.y;
+            prev = {offset, offset};
+            recorder.record(event);
+        }
+        if (frame % 50 == 10 || frame % 50 == 11) {
+            event.type = frame % 50 == 10 ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP;
+            event.button.button = SDL_BUTTON_LEFT;
+            event.button.x = prev.x;
+            event.button.y = prev.y;
+            recorder.record(event);
+        }
+        recorder.end_frame();
+    }
+    return InputLog(recorder.bytes());
+}
+
+InputPlayer::Report run(HeadlessVideo &video, int columns, bool indexed) {
+    std::vector<WidgetBase<MouseMgr> *> buttons;
+    buttons.reserve(static_cast<size_t>(columns) * columns);
+    for (int y = 0; y < columns; y++)
+        for (int x = 0; x < columns; x++)
+            buttons.push_back(new Button<MouseMgr>({x * button_size, y * button_size},
+                                                   {button_size, button_size}));
+    Page<MouseMgr> page({0, 0}, buttons, true);
+    page.set_hit_index(indexed);
+    auto log = mouse_log(columns * button_size);
+    MouseMgr mgr;
+    return InputPlayer(log).play(mgr, page, video.get_renderer());
+}
+
+int main(int, char *[]) {
+    HeadlessVideo video({100 * button_size, 100 * button_size});
+    std::printf("%8s %8s %10s %10s %10s\n", "widgets", "index", "p50 ms", "p99 ms", "max ms");
+    for (int columns: {10, 32, 100}) {
+        for (bool indexed: {false, true}) {
+            auto report = run(video, columns, indexed);
+            std::printf("%8d %8s %10.4f %10.4f %10.4f\n", columns * columns, indexed ? "grid" : "none",
+                        report.process.p50, report.process.p99, report.process.max);
+        }
+    }
+    return 0;
+}